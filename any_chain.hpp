@@ -0,0 +1,247 @@
+#pragma once
+
+#include "any_range.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <functional> //ref
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tyti {
+
+/// Concatenation of any_ranges of (possibly) different wrapped types, iterated as one range,
+/// e.g. a std::vector, followed by a std::list, followed by a std::map.
+/// The algorithms (for_each, accumulate, ...) run segment by segment with the algorithms of any_range,
+/// so the dispatch is done once per segment (or block of elements) and not per element.
+/// The iterators keep a single any_iterator, which is reassigned when crossing into the next segment.
+/// Segments of the same wrapped type are assigned in place, so heap stored iterators are only
+/// reallocated when the wrapped type changes.
+/// Iterators are invalidated by append.
+template<typename T, typename... Options>
+class any_chain
+{
+public:
+    using range_type = any_range<T, Options...>;
+    using value_type = typename range_type::value_type;
+    using reference = typename range_type::reference;
+    using pointer = typename range_type::pointer;
+
+private:
+    using segment_iterator = typename range_type::iterator;
+    static constexpr bool is_bidirectional = std::is_base_of<std::bidirectional_iterator_tag,
+        typename std::iterator_traits<segment_iterator>::iterator_category>::value;
+
+    std::vector<range_type> segments_;
+
+public:
+    /// Bidirectional (forward for forward any_ranges) iterator over all segments.
+    /// Every position is inside of a non empty segment, or the end.
+    class iterator
+    {
+        const std::vector<range_type>* segments_;
+        std::size_t index_;
+        segment_iterator it_;
+
+        friend class any_chain;
+
+        const range_type& segment() const { return (*segments_)[index_]; }
+
+        // positions at the beginning of segment _index, skips empty segments
+        iterator(const std::vector<range_type>* _segments, std::size_t _index)
+            : segments_(_segments), index_(_index), it_()
+        {
+            if (index_ < segments_->size())
+            {
+                segment().assign_first(it_);
+                skip_finished();
+            }
+        }
+
+        iterator(const std::vector<range_type>* _segments, std::size_t _index, segment_iterator&& _it)
+            : segments_(_segments), index_(_index), it_(std::move(_it))
+        {
+            skip_finished();
+        }
+
+        // moves to the next non empty segment when it_ reached the end of its segment
+        void skip_finished()
+        {
+            while (index_ < segments_->size() && segment().is_last(it_))
+            {
+                if (++index_ < segments_->size())
+                    segment().assign_first(it_);
+            }
+        }
+
+    public:
+        using iterator_category = typename std::conditional<is_bidirectional,
+            std::bidirectional_iterator_tag, std::forward_iterator_tag>::type;
+        using value_type = typename any_chain::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename any_chain::pointer;
+        using reference = typename any_chain::reference;
+
+        iterator() : segments_(nullptr), index_(0), it_() {}
+
+        reference operator*() const { return *it_; }
+        pointer operator->() const { return it_.operator->(); }
+
+        iterator& operator++()
+        {
+            assert(index_ < segments_->size() && "increment of the end iterator");
+            ++it_;
+            skip_finished();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        iterator& operator--()
+        {
+            static_assert(is_bidirectional, "decrement requires bidirectional any_ranges");
+            if (index_ == segments_->size())
+            {
+                --index_;
+                segment().assign_last(it_);
+            }
+            while (segment().is_first(it_))
+            {
+                assert(index_ > 0 && "decrement of the begin iterator");
+                --index_;
+                segment().assign_last(it_);
+            }
+            --it_;
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator tmp(*this);
+            --*this;
+            return tmp;
+        }
+
+        /// index of the current segment, the number of segments for the end
+        std::size_t segment_index() const { return index_; }
+
+        bool operator==(const iterator& _rhs) const
+        {
+            assert(segments_ == _rhs.segments_);
+            return index_ == _rhs.index_ && (index_ == segments_->size() || it_ == _rhs.it_);
+        }
+
+        bool operator!=(const iterator& _rhs) const
+        {
+            return !operator==(_rhs);
+        }
+    };
+    using const_iterator = iterator;
+
+    any_chain() {}
+
+    any_chain(std::initializer_list<range_type> _segments)
+        : segments_(_segments)
+    {
+    }
+
+    /// appends a segment, invalidates all iterators
+    void append(range_type _segment)
+    {
+        segments_.push_back(std::move(_segment));
+    }
+
+    /// appends the native range [_first, _last)
+    template<typename IterType>
+    void append(IterType _first, IterType _last)
+    {
+        segments_.push_back(range_type(std::move(_first), std::move(_last)));
+    }
+
+    const std::vector<range_type>& segments() const { return segments_; }
+
+    iterator begin() const { return iterator(&segments_, 0); }
+    iterator end() const { return iterator(&segments_, segments_.size()); }
+
+    bool empty() const
+    {
+        for (const range_type& segment : segments_)
+            if (!segment.empty())
+                return false;
+        return true;
+    }
+
+    /// Number of elements, see any_range::size
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (const range_type& segment : segments_)
+            n += segment.size();
+        return n;
+    }
+
+    /// Applies _f to every element, see any_range::for_each
+    template<typename F>
+    F for_each(F _f) const
+    {
+        for (const range_type& segment : segments_)
+            segment.for_each(std::ref(_f));
+        return _f;
+    }
+
+    /// Sums up all elements with operator+, one native loop per segment
+    value_type accumulate(value_type _init) const
+    {
+        for (const range_type& segment : segments_)
+            _init = segment.accumulate(std::move(_init));
+        return _init;
+    }
+
+    template<typename Acc, typename BinaryOp>
+    Acc accumulate(Acc _init, BinaryOp _op) const
+    {
+        for (const range_type& segment : segments_)
+            _init = segment.accumulate(std::move(_init), _op);
+        return _init;
+    }
+
+    /// Returns an iterator to the first element which satisfies _pred or end().
+    template<typename Pred>
+    iterator find_if(Pred _pred) const
+    {
+        for (std::size_t i = 0; i < segments_.size(); ++i)
+        {
+            segment_iterator it = segments_[i].find_if(_pred);
+            if (!segments_[i].is_last(it))
+                return iterator(&segments_, i, std::move(it));
+        }
+        return end();
+    }
+
+    template<typename Pred>
+    std::size_t count_if(Pred _pred) const
+    {
+        std::size_t count = 0;
+        for (const range_type& segment : segments_)
+            count += segment.count_if(_pred);
+        return count;
+    }
+
+    template<typename OutputIt>
+    OutputIt copy(OutputIt _out) const
+    {
+        for (const range_type& segment : segments_)
+            _out = segment.copy(std::move(_out));
+        return _out;
+    }
+};
+
+} // end namespace tyti
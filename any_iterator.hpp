@@ -2,272 +2,1363 @@
 
 #include <iterator>
 
-#include <cstdlib> //malloc, realloc
-#include <exception> //bad_alloc
+#include <algorithm> //min
+#include <array>
+
+#include <cassert>
+#include <cstddef> //size_t, max_align_t
+#include <cstdint> //uintptr_t
+#include <cstring> //memcpy
+#include <memory> //allocator, allocator_traits
+#include <new> //placement new
 #include <type_traits>
 #include <utility>
 
+#include "iterator_stats.hpp"
+#include "type_registry.hpp"
+
 namespace tyti {
+
+/// Option for any_iterator: size and alignment of the inline buffer.
+/// Iterators which fit into the buffer are stored inside of the any_iterator,
+/// all others are stored on the heap.
+template<std::size_t Bytes = 4 * sizeof(void*), std::size_t Align = alignof(void*)>
+struct inline_buffer
+{
+    static_assert(Bytes >= sizeof(void*), "inline buffer must be able to hold a pointer");
+    static_assert(Align >= alignof(void*) && (Align & (Align - 1)) == 0, "invalid alignment");
+
+    static constexpr std::size_t size = Bytes;
+    static constexpr std::size_t align = Align;
+};
+
+/// Option for any_iterator: dereference returns the value instead of a reference.
+/// Allows wrapping iterators whose operator* returns by value or a proxy,
+/// e.g. std::vector<bool>::iterator, transform iterators or generators.
+struct by_value {};
+
+/// Option for any_iterator: keeps the result of the last dereference (the address of the element,
+/// or the value with tyti::by_value) inside of the any_iterator, so repeated * and -> at one position
+/// call the wrapped iterator once. For iterators with an expensive operator*, e.g. decompression or joins.
+/// Increment, decrement, advance and assignment drop the cached result, copies start without one.
+/// Only wrapped types with is_pure_deref are cached.
+/// Costs one pointer per any_iterator, or the value and a flag with tyti::by_value.
+struct cache_deref {};
+
+/// Dispatch policies of any_iterator, given as option. They select how ++, == and * reach the
+/// wrapped iterator, the storage (inline buffer or heap), the allocator and all other operations are shared.
+/// Which one is the fastest depends on compiler, container and loop, see benchmark_iteration in tests/benchmark.cpp.
+/// Default: ++, == and * are called through the function table of the wrapped type.
+struct table_dispatch {};
+
+/// Stores the hot entries of the function table (increment, comparison and dereference) inside of the
+/// any_iterator instead of behind the table pointer.
+/// Saves the dependent load of the table per ++, == and *, at the cost of three pointers per any_iterator.
+struct inline_dispatch {};
+
+/// ++, == and * are virtual functions of one static object per wrapped type (the vtable dispatch of
+/// a class hierarchy of iterator holders). Costs one pointer per any_iterator.
+struct virtual_dispatch {};
+
+/// ++, == and * of the listed iterator types are dispatched with a switch over their index and are inlined,
+/// like variant_iterator. Other wrapped types are called through the function table. Costs one index per any_iterator.
+template<typename... Iters>
+struct switch_dispatch {};
+
+/// Option for any_iterator: registers the visitor types which can be passed to tyti::visit.
+/// The function table of every wrapped type gets one entry per visitor, which calls the visitor
+/// with the native iterators. Every visitor has to be callable with (Iter& first, const Iter& last)
+/// for every wrapped iterator type Iter, e.g. a struct with a templated operator() or a generic lambda.
+/// tyti::visit returns Visitor::result_type if it is declared, void otherwise.
+template<typename... Visitors>
+struct visitors {};
+
+/// True for iterators which are equal if and only if their bytes are equal, e.g. iterators holding one pointer.
+/// any_iterator compares pointer sized iterators of such types without an indirect call.
+/// Can be specialized for user iterators.
+template<typename Iter>
+struct is_bitwise_comparable : std::is_pointer<Iter> {};
+
+#if defined(__GLIBCXX__)
+// std::vector and std::basic_string iterators (not the checked ones of _GLIBCXX_DEBUG)
+template<typename Ptr, typename Container>
+struct is_bitwise_comparable<__gnu_cxx::__normal_iterator<Ptr, Container>> : std::is_pointer<Ptr> {};
+#elif defined(_LIBCPP_VERSION)
+template<typename Ptr>
+struct is_bitwise_comparable<std::__wrap_iter<Ptr>> : std::is_pointer<Ptr> {};
+#endif
+
+/// True for iterators whose operator* returns the same element (or an equal value) every time
+/// it is called at one position, so the tyti::cache_deref option may keep the result.
+/// Can be specialized as false for iterators which have to be dereferenced every time,
+/// e.g. when the element is changed behind the iterator.
+template<typename Iter>
+struct is_pure_deref : std::true_type {};
+
+namespace detail {
+
+template<typename T>
+struct identity { using type = T; };
+
+// returns the first option which satisfies Pred or Default if none does
+template<template<typename> class Pred, typename Default, typename... Options>
+struct find_option : identity<Default> {};
+
+template<template<typename> class Pred, typename Default, typename Opt, typename... Options>
+struct find_option<Pred, Default, Opt, Options...>
+    : std::conditional<Pred<Opt>::value, identity<Opt>, find_option<Pred, Default, Options...>>::type {};
+
+template<typename T>
+struct is_by_value : std::is_same<by_value, T> {};
+
+template<typename T>
+struct is_cache_deref : std::is_same<cache_deref, T> {};
+
+template<typename T>
+struct is_dispatch : std::false_type {};
+template<>
+struct is_dispatch<table_dispatch> : std::true_type {};
+template<>
+struct is_dispatch<inline_dispatch> : std::true_type {};
+template<>
+struct is_dispatch<virtual_dispatch> : std::true_type {};
+template<typename... Iters>
+struct is_dispatch<switch_dispatch<Iters...>> : std::true_type {};
+
+// position of Iter in Iters, the number of types if it is not listed
+template<typename Iter, typename... Iters>
+struct switch_index : std::integral_constant<std::size_t, 0> {};
+template<typename Iter, typename I, typename... Iters>
+struct switch_index<Iter, I, Iters...> : std::integral_constant<std::size_t,
+    std::is_same<Iter, I>::value ? 0 : 1 + switch_index<Iter, Iters...>::value> {};
+
+// constant initialized object of T, e.g. the virtual entries of a wrapped type
+template<typename T>
+struct static_instance
+{
+    static const T value;
+};
+
+template<typename T>
+const T static_instance<T>::value{};
+
+template<typename T>
+struct is_count_stats : std::is_same<count_stats, T> {};
+
+template<typename T>
+struct is_visitors : std::false_type {};
+template<typename... Visitors>
+struct is_visitors<visitors<Visitors...>> : std::true_type {};
+
+// position of Visitor in Visitors, the number of visitors if it is not registered
+template<typename Visitor, typename Visitors>
+struct visitor_index : std::integral_constant<std::size_t, 0> {};
+template<typename Visitor, typename V, typename... Visitors>
+struct visitor_index<Visitor, visitors<V, Visitors...>> : std::integral_constant<std::size_t,
+    std::is_same<Visitor, V>::value ? 0 : 1 + visitor_index<Visitor, visitors<Visitors...>>::value> {};
+
+template<typename Visitor, typename = void>
+struct visitor_result : identity<void> {};
+template<typename Visitor>
+struct visitor_result<Visitor, decltype(void(std::declval<typename Visitor::result_type>()))>
+    : identity<typename Visitor::result_type> {};
+
+// calls a visit entry of the function table, non-void results are constructed in a local buffer
+template<typename R, typename Fn>
+R call_visit_entry(Fn _fn, void* _first, const void* _last, void* _visitor, std::true_type)
+{
+    _fn(_first, _last, _visitor, nullptr);
+}
+
+template<typename R, typename Fn>
+R call_visit_entry(Fn _fn, void* _first, const void* _last, void* _visitor, std::false_type)
+{
+    typename std::aligned_storage<sizeof(R), alignof(R)>::type buffer;
+    _fn(_first, _last, _visitor, &buffer);
+    R& result = *reinterpret_cast<R*>(&buffer);
+    R ret(std::move(result));
+    result.~R();
+    return ret;
+}
+
+// pointer type of by_value any_iterators, keeps the value alive for operator->
+template<typename T>
+class arrow_proxy
+{
+    T value_;
+public:
+    explicit arrow_proxy(T&& _value) : value_(std::move(_value)) {}
+    const T* operator->() const { return &value_; }
+};
+
+// result of the dereference inside of the function table, see any_iterator::block_type
+template<typename T, bool ByValue>
+struct block_of : std::conditional<ByValue, typename std::remove_cv<typename std::remove_reference<T>::type>::type,
+    typename std::conditional<std::is_reference<T>::value, typename std::remove_reference<T>::type, const T>::type*> {};
+
+// last result of the dereference of an any_iterator, see tyti::cache_deref. Empty without the option.
+template<typename Block, bool Enabled>
+class deref_cache
+{
+protected:
+    void reset_cache() const {}
+};
+
+// values of by_value any_iterators
+template<typename Block>
+class deref_cache<Block, true>
+{
+    mutable typename std::aligned_storage<sizeof(Block), alignof(Block)>::type value_;
+    mutable bool valid_;
+
+protected:
+    deref_cache() : valid_(false) {}
+    // a copy of the iterator is dereferenced again, the result of a stashing iterator can differ
+    deref_cache(const deref_cache&) : valid_(false) {}
+    deref_cache& operator=(const deref_cache&) = delete;
+    ~deref_cache() { reset_cache(); }
+
+    const Block* cached() const { return valid_ ? reinterpret_cast<const Block*>(&value_) : nullptr; }
+
+    const Block& cache(Block&& _value) const
+    {
+        ::new (static_cast<void*>(&value_)) Block(std::move(_value));
+        valid_ = true;
+        return *cached();
+    }
+
+    void reset_cache() const
+    {
+        if (valid_)
+        {
+            valid_ = false;
+            reinterpret_cast<Block*>(&value_)->~Block();
+        }
+    }
+};
+
+// addresses of the elements, nullptr when nothing is cached
+template<typename Elem>
+class deref_cache<Elem*, true>
+{
+    mutable Elem* ptr_;
+
+protected:
+    deref_cache() : ptr_(nullptr) {}
+    deref_cache(const deref_cache&) : ptr_(nullptr) {}
+    deref_cache& operator=(const deref_cache&) = delete;
+
+    Elem* const* cached() const { return ptr_ ? &ptr_ : nullptr; }
+    Elem* const& cache(Elem*&& _ptr) const { ptr_ = _ptr; return ptr_; }
+    void reset_cache() const { ptr_ = nullptr; }
+};
+
+template<typename T, typename... Options>
+using deref_cache_of = deref_cache<
+    typename block_of<T, is_by_value<typename find_option<is_by_value, void, Options...>::type>::value>::type,
+    is_cache_deref<typename find_option<is_cache_deref, void, Options...>::type>::value>;
+
+// any type with value_type and allocate(n) can be given as allocator option
+template<typename T, typename = void>
+struct is_allocator_impl : std::false_type {};
+template<typename T>
+struct is_allocator_impl<T, decltype(void(std::declval<typename T::value_type>()),
+    void(std::declval<T&>().allocate(std::size_t(1))))> : std::true_type {};
+template<typename T>
+struct is_allocator : is_allocator_impl<T> {};
+
+// stores the allocator, empty allocators are not stored (empty base optimization)
+template<typename Alloc, bool = std::is_empty<Alloc>::value && std::is_default_constructible<Alloc>::value>
+class allocator_holder
+{
+protected:
+    allocator_holder() {}
+    explicit allocator_holder(const Alloc&) {}
+    Alloc get_alloc() const { return Alloc(); }
+    bool equal_alloc(const allocator_holder&) const { return true; }
+};
+
+template<typename Alloc>
+class allocator_holder<Alloc, false>
+{
+    Alloc alloc_;
+protected:
+    allocator_holder() : alloc_() {}
+    explicit allocator_holder(const Alloc& _alloc) : alloc_(_alloc) {}
+    const Alloc& get_alloc() const { return alloc_; }
+    bool equal_alloc(const allocator_holder& _rhs) const { return alloc_ == _rhs.alloc_; }
+};
+
+template<typename T>
+struct is_inline_buffer : std::false_type {};
+template<std::size_t Bytes, std::size_t Align>
+struct is_inline_buffer<inline_buffer<Bytes, Align>> : std::true_type {};
+
+// iterator tags can be given as option to choose the category of the any_iterator
+template<typename T>
+struct is_iterator_category : std::integral_constant<bool,
+    std::is_base_of<std::input_iterator_tag, T>::value || std::is_same<std::output_iterator_tag, T>::value> {};
+
+// used for the fallback overloads of the tag dispatching, matches every category
+struct any_category
+{
+    template<typename Tag>
+    constexpr any_category(Tag) {}
+};
+
+template<typename Iter, typename Category>
+struct satisfies_category
+    : std::is_base_of<Category, typename std::iterator_traits<Iter>::iterator_category> {};
+
+// mutable forward iterators are output iterators as well
+template<typename Iter>
+struct satisfies_category<Iter, std::output_iterator_tag>
+    : std::integral_constant<bool,
+        std::is_same<std::output_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>::value
+        || std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>::value> {};
+
+#if defined(__cpp_lib_concepts)
+// contiguous iterators report random_access as their iterator_category
+template<typename Iter>
+struct satisfies_category<Iter, std::contiguous_iterator_tag>
+    : std::integral_constant<bool, std::contiguous_iterator<Iter>> {};
+#endif
+
+} // end namespace detail
+
+template<typename T, typename... Options>
+class any_iterator;
+
+template<typename T, typename... Options>
+class any_range;
+
+template<typename T, typename... Options>
+class any_sentinel;
+
+namespace detail {
+
+template<typename T, typename = void>
+struct is_iterator : std::false_type {};
+template<typename T>
+struct is_iterator<T, decltype(void(std::declval<typename std::iterator_traits<T>::iterator_category>()))> : std::true_type {};
+
+template<typename T, typename = void>
+struct is_random_access_iterator : std::false_type {};
+template<typename T>
+struct is_random_access_iterator<T, typename std::enable_if<std::is_base_of<std::random_access_iterator_tag,
+    typename std::iterator_traits<T>::iterator_category>::value>::type> : std::true_type {};
+
 template<typename T>
-class any_iterator : public std::iterator<std::bidirectional_iterator_tag, T>
+struct is_any_iterator : std::false_type {};
+template<typename T, typename... Options>
+struct is_any_iterator<any_iterator<T, Options...>> : std::true_type {};
+
+// iterator which can be wrapped by an any_iterator
+template<typename T>
+struct is_native_iterator : std::integral_constant<bool, is_iterator<T>::value && !is_any_iterator<T>::value> {};
+
+template<typename T, typename = void>
+struct is_addable : std::false_type {};
+template<typename T>
+struct is_addable<T, decltype(void(std::declval<T&>() = std::declval<const T&>() + std::declval<const T&>()))> : std::true_type {};
+
+// number of elements fetched per indirect call by the blockwise algorithms
+constexpr std::size_t block_size = 64;
+
+template<typename Iter, typename F>
+F for_each_blockwise(Iter& _first, const Iter& _last, F _f, std::forward_iterator_tag)
+{
+    typename Iter::block_type block[block_size];
+    while (const std::size_t n = _first.next_block(_last, block, block_size))
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            _f(Iter::from_block(block[i]));
+    }
+    return _f;
+}
+
+// the addresses of input iterators elements are not stable over increments
+template<typename Iter, typename F>
+F for_each_blockwise(Iter& _first, const Iter& _last, F _f, std::input_iterator_tag)
+{
+    for (; _first != _last; ++_first)
+        _f(*_first);
+    return _f;
+}
+
+} // end namespace detail
+
+template<typename T, typename... Options>
+class any_iterator : private detail::allocator_holder<
+    typename detail::find_option<detail::is_allocator, std::allocator<unsigned char>, Options...>::type>,
+    private detail::deref_cache_of<T, Options...>
 {
+public:
+    /// allocator for iterators which do not fit into the inline buffer.
+    /// Given as option, std::allocator by default.
+    /// The allocator is fixed at construction, assignments do not propagate it.
+    using allocator_type = typename detail::find_option<detail::is_allocator, std::allocator<unsigned char>, Options...>::type;
+
+    using iterator_category = typename detail::find_option<detail::is_iterator_category, std::bidirectional_iterator_tag, Options...>::type;
+    using value_type = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
+    using difference_type = std::ptrdiff_t;
+
+private:
+    using by_value_t = std::integral_constant<bool,
+        detail::is_by_value<typename detail::find_option<detail::is_by_value, void, Options...>::type>::value>;
+    using dispatch_t = typename detail::find_option<detail::is_dispatch, table_dispatch, Options...>::type;
+    using cache_deref_t = std::integral_constant<bool,
+        detail::is_cache_deref<typename detail::find_option<detail::is_cache_deref, void, Options...>::type>::value>;
+#if defined(TYTI_ANY_ITERATOR_STATS)
+    using count_stats_t = std::true_type;
+#else
+    using count_stats_t = std::integral_constant<bool,
+        detail::is_count_stats<typename detail::find_option<detail::is_count_stats, void, Options...>::type>::value>;
+#endif
+    using visitors_t = typename detail::find_option<detail::is_visitors, visitors<>, Options...>::type;
+    // any_iterator<T> gives const access, any_iterator<T&> gives mutable access
+    using element_type = typename std::conditional<std::is_reference<T>::value,
+        typename std::remove_reference<T>::type, const T>::type;
+
+public:
+    using pointer = typename std::conditional<by_value_t::value, detail::arrow_proxy<value_type>, element_type*>::type;
+    using reference = typename std::conditional<by_value_t::value, value_type, element_type&>::type;
+    /// result of the dereference inside of the function table, also used by next_block:
+    /// the address of the element or the element itself for by_value any_iterators
+    using block_type = typename detail::block_of<T, by_value_t::value>::type;
+
+    static reference from_block(const block_type& _elem) {
+        return from_block_impl(_elem, by_value_t());
+    }
+
+private:
+    using alloc_base = detail::allocator_holder<allocator_type>;
+    using cache_base = detail::deref_cache_of<T, Options...>;
+    using buffer_t = typename detail::find_option<detail::is_inline_buffer, inline_buffer<>, Options...>::type;
+    using category_t = iterator_category;
+
+    static constexpr bool is_output = std::is_same<std::output_iterator_tag, category_t>::value;
+    static constexpr bool is_forward = std::is_base_of<std::forward_iterator_tag, category_t>::value;
+    static constexpr bool is_bidirectional = std::is_base_of<std::bidirectional_iterator_tag, category_t>::value;
+    static constexpr bool is_random_access = std::is_base_of<std::random_access_iterator_tag, category_t>::value;
+
     //functionpointer save structurez
+    // all functions get the address of the storage, not of the iterator.
+    // the conversion is done inside, where the type is known at compile time.
+    using inc_t = void(*)(void*);
+    using equal_t = bool(*)(const void*, const void*);
+    using deref_t = block_type(*)(const void*);
+    using assign_t = void(*)(void*, const value_type&);
+    using advance_t = void(*)(void*, std::ptrdiff_t);
+    using distance_t = std::ptrdiff_t(*)(const void*, const void*);
+    using subscript_t = block_type(*)(const void*, std::ptrdiff_t);
+    using next_block_t = std::size_t(*)(void*, const void*, block_type*, std::size_t);
+    using skip_t = std::size_t(*)(void*, const void*, std::size_t);
+    using accumulate_t = value_type(*)(const void*, const void*, value_type);
+    using stats_t = iterator_stats*(*)();
+    // (first, last, visitor, storage of the result), see tyti::visit
+    using visit_t = void(*)(void*, const void*, void*, void*);
+    template<typename Visitors>
+    struct visit_table;
+    template<typename... Visitors>
+    struct visit_table<visitors<Visitors...>> { using type = std::array<visit_t, sizeof...(Visitors)>; };
+    using visit_table_t = typename visit_table<visitors_t>::type;
+
+    struct TypeInfos;
+
+    // Handles to the function table of the wrapped type, one per dispatch policy (see tyti::table_dispatch).
+    // They convert to the table pointer, the hot entries are called through inc/equal/deref.
+    // entry<IterType>() is stored in the table of IterType, for the policies which need data per type.
+
+    // tyti::table_dispatch
+    class table_pointer
+    {
+        const TypeInfos* ti_;
+    public:
+        using entry_type = std::nullptr_t;
+        template<typename IterType>
+        static constexpr entry_type entry() { return nullptr; }
+
+        table_pointer(const TypeInfos* _ti) : ti_(_ti) {}
+        operator const TypeInfos*() const { return ti_; }
+        const TypeInfos* operator->() const { return ti_; }
+
+        void inc(void* _storage) const { ti_->inc_fn(_storage); }
+        bool equal(const void* _lhs, const void* _rhs) const { return equals(ti_, _lhs, _rhs); }
+        block_type deref(const void* _storage) const { return ti_->deref_fn(_storage); }
+    };
+
+    // tyti::inline_dispatch layout: copies of the hot entries are kept next to the table pointer
+    class table_inline
+    {
+        const TypeInfos* ti_;
+        inc_t inc_fn_;
+        equal_t equal_fn_;
+        deref_t deref_fn_;
+    public:
+        using entry_type = std::nullptr_t;
+        template<typename IterType>
+        static constexpr entry_type entry() { return nullptr; }
+
+        table_inline(const TypeInfos* _ti)
+            : ti_(_ti), inc_fn_(_ti->inc_fn), equal_fn_(_ti->equal_fn), deref_fn_(_ti->deref_fn) {}
+        operator const TypeInfos*() const { return ti_; }
+        const TypeInfos* operator->() const { return ti_; }
+
+        void inc(void* _storage) const { inc_fn_(_storage); }
+        bool equal(const void* _lhs, const void* _rhs) const { return equal_fn_ ? equal_fn_(_lhs, _rhs) : word(_lhs) == word(_rhs); }
+        block_type deref(const void* _storage) const { return deref_fn_(_storage); }
+    };
+
+    // tyti::virtual_dispatch: the hot entries as virtual functions, one static object per wrapped type.
+    // The entries of the table are constants for the overrides, so the wrapped operations are inlined into them.
+    struct virtual_entries
+    {
+        virtual void inc(void* _storage) const = 0;
+        virtual bool equal(const void* _lhs, const void* _rhs) const = 0;
+        virtual block_type deref(const void* _storage) const = 0;
+    };
+
+    template<typename IterType>
+    struct virtual_entries_of final : virtual_entries
+    {
+        constexpr virtual_entries_of() {}
+        void inc(void* _storage) const override { any_iterator::inc<IterType>(_storage); }
+        bool equal(const void* _lhs, const void* _rhs) const override { return equals(getFunctionInfos<IterType>(), _lhs, _rhs); }
+        block_type deref(const void* _storage) const override { return getFunctionInfos<IterType>()->deref_fn(_storage); }
+    };
+
+    class table_virtual
+    {
+        const TypeInfos* ti_;
+        const virtual_entries* entries_;
+    public:
+        using entry_type = const virtual_entries*;
+        template<typename IterType>
+        static constexpr entry_type entry() { return &detail::static_instance<virtual_entries_of<IterType>>::value; }
+
+        table_virtual(const TypeInfos* _ti) : ti_(_ti), entries_(_ti->dispatch) {}
+        operator const TypeInfos*() const { return ti_; }
+        const TypeInfos* operator->() const { return ti_; }
+
+        void inc(void* _storage) const { entries_->inc(_storage); }
+        bool equal(const void* _lhs, const void* _rhs) const { return entries_->equal(_lhs, _rhs); }
+        block_type deref(const void* _storage) const { return entries_->deref(_storage); }
+    };
+
+    // tyti::switch_dispatch: compares the index of the wrapped type with the index of every listed type
+    // (compiled to a jump table or a short compare chain), the wrapped operations are inlined.
+    // Types which are not listed have the index sizeof...(Iters) and are called through the table.
+    template<typename... Iters>
+    class table_switch
+    {
+        const TypeInfos* ti_;
+        std::size_t index_;
+
+        template<std::size_t I, typename Iter, typename... Rest>
+        void inc_at(void* _storage) const
+        {
+            if (index_ == I)
+                any_iterator::inc<Iter>(_storage);
+            else
+                inc_at<I + 1, Rest...>(_storage);
+        }
+        template<std::size_t I>
+        void inc_at(void* _storage) const { ti_->inc_fn(_storage); }
+
+        template<std::size_t I, typename Iter, typename... Rest>
+        bool equal_at(const void* _lhs, const void* _rhs) const
+        {
+            return index_ == I ? equals(getFunctionInfos<Iter>(), _lhs, _rhs) : equal_at<I + 1, Rest...>(_lhs, _rhs);
+        }
+        template<std::size_t I>
+        bool equal_at(const void* _lhs, const void* _rhs) const { return equals(ti_, _lhs, _rhs); }
+
+        template<std::size_t I, typename Iter, typename... Rest>
+        block_type deref_at(const void* _storage) const
+        {
+            return index_ == I ? getFunctionInfos<Iter>()->deref_fn(_storage) : deref_at<I + 1, Rest...>(_storage);
+        }
+        template<std::size_t I>
+        block_type deref_at(const void* _storage) const { return ti_->deref_fn(_storage); }
+
+    public:
+        using entry_type = std::size_t;
+        template<typename IterType>
+        static constexpr entry_type entry() { return detail::switch_index<IterType, Iters...>::value; }
+
+        table_switch(const TypeInfos* _ti) : ti_(_ti), index_(_ti->dispatch) {}
+        operator const TypeInfos*() const { return ti_; }
+        const TypeInfos* operator->() const { return ti_; }
+
+        void inc(void* _storage) const { inc_at<0, Iters...>(_storage); }
+        bool equal(const void* _lhs, const void* _rhs) const { return equal_at<0, Iters...>(_lhs, _rhs); }
+        block_type deref(const void* _storage) const { return deref_at<0, Iters...>(_storage); }
+    };
+
+    static table_pointer handle_of(table_dispatch);
+    static table_inline handle_of(inline_dispatch);
+    static table_virtual handle_of(virtual_dispatch);
+    template<typename... Iters>
+    static table_switch<Iters...> handle_of(switch_dispatch<Iters...>);
+
+    using table_t = decltype(handle_of(dispatch_t()));
+
     struct TypeInfos
     {
-        void(*const inc_fn)(void*);
-        void(*const dec_fn)(void*);
-        const bool(*const equal_fn)(const void*,const void*);
-        const T*(*const deref_fn)(const void*);
-        void(*const dtor_fn)(void*);
-        void(*const copy_ctor_fn)(void**,const void*);
-        void(*const move_ctor_fn)(void**, const void*);
+        const inc_t inc_fn;
+        const inc_t dec_fn;
+        // not available for output iterators. nullptr for bitwise comparable types, see equals
+        const equal_t equal_fn;
+        const deref_t deref_fn;
+        // see is_pure_deref, only read with the tyti::cache_deref option
+        const bool pure_deref;
+        // only available for output iterators
+        const assign_t assign_fn;
+        // nullptr for trivial types, see destroy/copy/relocate
+        void(*const dtor_fn)(void*, const allocator_type&);
+        void(*const copy_ctor_fn)(void*, const void*, const allocator_type&);
+        void(*const move_ctor_fn)(void*, void*);
+        // assignment to an iterator of the same type, keeps the heap block.
+        // nullptr for trivial and not copy assignable types
+        void(*const copy_assign_fn)(void*, const void*);
+        // only available for random access iterators
+        const advance_t advance_fn;
+        const distance_t distance_fn;
+        const subscript_t subscript_fn;
+        const equal_t less_fn;
+        // only available for forward iterators
+        const next_block_t next_block_fn;
+        // advances by up to n elements but not behind the end, O(1) for random access iterators
+        const skip_t skip_fn;
+        // native std::accumulate over [first, last), only available if value_type supports operator+
+        const accumulate_t accumulate_fn;
         const size_t size;
+        // identity of the wrapped type, equal for the copies of this table in other shared libraries
+        const type_key* key;
+        // data of the dispatch policy, see the table handles
+        const typename table_t::entry_type dispatch;
+        // counters of the wrapped type, only set with the tyti::count_stats option
+        const stats_t stats_fn;
+        // one entry per visitor of the tyti::visitors option, nullptr for the empty any_iterator
+        const visit_table_t visit_fns;
     };
 
     template<typename IterType>
-    TypeInfos* getFunctionInfos()
+    static const TypeInfos* getFunctionInfos()
     {
-        static TypeInfos ti =
+        using entries = category_entries<IterType>;
+        // constant initialized, constructions do not pass a static initialization guard
+        static constexpr TypeInfos ti =
         {
             &any_iterator::inc<IterType>,
-            &any_iterator::dec<IterType>,
-            &any_iterator::equal<IterType>,
-            &any_iterator::deref<IterType>,
-            //(std::is_trivially_destructible<IterType>::value) ? 
-            //static_cast<void(*)(void*)>(nullptr) : 
-            &any_iterator::dtor<IterType>,
-            //(std::is_trivially_copy_constructible<IterType>::value) ?
-            //static_cast<void(*)(void*,const void*)>(nullptr) :
-            &any_iterator::copyConstructor<IterType>,
-            &any_iterator::moveConstructor<IterType>,
-            sizeof(IterType)
+            entries::dec(category_t()),
+            entries::equal(category_t(), std::integral_constant<bool, is_bitwise<IterType>() && !count_stats_t::value>()),
+            entries::deref(category_t()),
+            is_pure_deref<IterType>::value,
+            entries::assign(category_t()),
+            (is_small<IterType>() && std::is_trivially_destructible<IterType>::value) ?
+            nullptr : &any_iterator::dtor<IterType>,
+            is_trivial<IterType>() ?
+            nullptr : &any_iterator::copyConstructor<IterType>,
+            // heap iterators are moved by stealing the pointer, which is a memcpy as well
+            (is_trivial<IterType>() || !is_small<IterType>()) ?
+            nullptr : &any_iterator::moveConstructor<IterType>,
+            entries::copy_assign(std::integral_constant<bool, !is_trivial<IterType>() && std::is_copy_assignable<IterType>::value>()),
+            entries::advance(category_t()),
+            entries::distance(category_t()),
+            entries::subscript(category_t()),
+            entries::less(category_t()),
+            entries::next_block(category_t()),
+            entries::skip(category_t()),
+            entries::accumulate(std::integral_constant<bool, !is_output && detail::is_addable<value_type>::value>()),
+            sizeof(IterType),
+            &type_key_of<IterType>::key,
+            table_t::template entry<IterType>(),
+            entries::stats(count_stats_t()),
+            entries::visit(visitors_t(), std::is_same<IterType, NoDestruct>())
         };
         return &ti;
     }
 
+    // entries which are only instantiated when the category provides the operation.
+    // The nullptr overloads are picked when no tag overload matches.
+    template<typename IterType>
+    struct category_entries
+    {
+        static constexpr inc_t dec(std::bidirectional_iterator_tag) { return &any_iterator::dec<IterType>; }
+        static constexpr inc_t dec(detail::any_category) { return nullptr; }
+        static constexpr equal_t equal(std::input_iterator_tag, std::false_type) { return &any_iterator::equal<IterType>; }
+        template<typename Bitwise>
+        static constexpr equal_t equal(detail::any_category, Bitwise) { return nullptr; }
+        static constexpr deref_t deref(std::input_iterator_tag) { return &any_iterator::deref<IterType>; }
+        static constexpr deref_t deref(detail::any_category) { return nullptr; }
+        static constexpr assign_t assign(std::output_iterator_tag) { return &any_iterator::assign_value<IterType>; }
+        static constexpr assign_t assign(detail::any_category) { return nullptr; }
+        static constexpr next_block_t next_block(std::forward_iterator_tag) { return &any_iterator::next_block<IterType>; }
+        static constexpr next_block_t next_block(detail::any_category) { return nullptr; }
+        static constexpr skip_t skip(std::forward_iterator_tag) { return &any_iterator::skip<IterType>; }
+        static constexpr skip_t skip(detail::any_category) { return nullptr; }
+        static constexpr accumulate_t accumulate(std::true_type) { return &any_iterator::accumulate<IterType>; }
+        static constexpr accumulate_t accumulate(std::false_type) { return nullptr; }
+        static constexpr advance_t advance(std::random_access_iterator_tag) { return &any_iterator::advance<IterType>; }
+        static constexpr advance_t advance(detail::any_category) { return nullptr; }
+        static constexpr distance_t distance(std::random_access_iterator_tag) { return &any_iterator::distance<IterType>; }
+        static constexpr distance_t distance(detail::any_category) { return nullptr; }
+        static constexpr subscript_t subscript(std::random_access_iterator_tag) { return &any_iterator::subscript<IterType>; }
+        static constexpr subscript_t subscript(detail::any_category) { return nullptr; }
+        static constexpr equal_t less(std::random_access_iterator_tag) { return &any_iterator::less<IterType>; }
+        static constexpr equal_t less(detail::any_category) { return nullptr; }
+        static constexpr void(*copy_assign(std::true_type))(void*, const void*) { return &any_iterator::copy_assign<IterType>; }
+        static constexpr void(*copy_assign(std::false_type))(void*, const void*) { return nullptr; }
+        static constexpr stats_t stats(std::true_type) { return &any_iterator::stats<IterType>; }
+        static constexpr stats_t stats(std::false_type) { return nullptr; }
+        template<typename... Visitors>
+        static constexpr visit_table_t visit(visitors<Visitors...>, std::false_type) { return {{ &any_iterator::visit_entry<IterType, Visitors>... }}; }
+        template<typename... Visitors>
+        static constexpr visit_table_t visit(visitors<Visitors...>, std::true_type) { return {{ no_visit<Visitors>()... }}; }
+        template<typename Visitor>
+        static constexpr visit_t no_visit() { return nullptr; }
+    };
+
+    template<typename IterType>
+    static void check_category()
+    {
+        static_assert(detail::satisfies_category<IterType, category_t>::value,
+            "the wrapped iterator does not satisfy the iterator category of the any_iterator");
+        static_assert(is_output || by_value_t::value
+            || std::is_reference<typename std::iterator_traits<IterType>::reference>::value,
+            "the wrapped iterator returns by value, use the tyti::by_value option");
+    }
+
+    // conversion of the wrapped iterators dereference into block_type and back
+    template<typename Ref>
+    static block_type to_block(Ref&& _ref, std::true_type)
+    {
+        return static_cast<value_type>(std::forward<Ref>(_ref));
+    }
+    static block_type to_block(element_type& _ref, std::false_type)
+    {
+        return &_ref;
+    }
+
+    static reference from_block_impl(const block_type& _elem, std::true_type)
+    {
+        return _elem;
+    }
+    static reference from_block_impl(const block_type& _elem, std::false_type)
+    {
+        return *_elem;
+    }
+
+    static pointer to_pointer(block_type&& _elem, std::true_type)
+    {
+        return pointer(std::move(_elem));
+    }
+    static pointer to_pointer(block_type&& _elem, std::false_type)
+    {
+        return _elem;
+    }
+
     // used to destruct nothing e.g. used when the l-value should not destruct anything
+    // or a copy into the storage failed.
     // Do not provide it to the user.
     struct NoDestruct
     {
-        ~NoDestruct() {} //only destructor is used
-
-        NoDestruct(const NoDestruct&) { assert(false); }
-        NoDestruct(NoDestruct&&) { assert(false); }
+        // trivial, so copies and destruction of the empty state are no-ops
+        ~NoDestruct() = default;
+        NoDestruct(const NoDestruct&) = default;
+        NoDestruct(NoDestruct&&) = default;
         NoDestruct operator++() { assert(false); return *this; }
         NoDestruct operator--() { assert(false); return *this; }
-        bool operator==(const NoDestruct&) const { assert(false); return false; }
-        bool operator!=(const NoDestruct&) const { assert(false); return false; }
+        bool operator==(const NoDestruct&) const { return true; }
+        bool operator!=(const NoDestruct&) const { return false; }
+        NoDestruct& operator+=(std::ptrdiff_t) { assert(false); return *this; }
+        std::ptrdiff_t operator-(const NoDestruct&) const { return 0; }
+        bool operator<(const NoDestruct&) const { return false; }
+        element_type& operator[](std::ptrdiff_t) const { return **this; }
         //this function will never be called. just for compile correctness
-        const T& operator*() const { assert(false); return *(reinterpret_cast<const T*>(this)); }
+        element_type& operator*() const { assert(false); return *(reinterpret_cast<element_type*>(const_cast<NoDestruct*>(this))); }
+        value_type& operator*() { assert(false); return *(reinterpret_cast<value_type*>(this)); }
     };
 
     // small buffer optimization
-    // when sizeof(Iter) <= sizeof(void*) aka type for the pointer
-    // no malloc is done, everything is saved in the pointer itself
-    // when the pointer is used as buffer, no deref is necessary
-    // below are some helper functions.
+    // when the iterator fits into the inline buffer (see tyti::inline_buffer)
+    // no malloc is done, everything is saved in the buffer itself.
+    // Otherwise, the first bytes of the buffer hold the pointer to the heap.
     // Almost all logic is inside the iter_type-defined functions like inc/dec etc.
     // which allows compile to have the buffer optimization without any overhead
-    constexpr static bool is_small(size_t size)
+    template<typename Iter>
+    constexpr static bool is_small()
+    {
+        return sizeof(Iter) <= buffer_t::size
+            && alignof(Iter) <= buffer_t::align
+            && std::is_nothrow_move_constructible<Iter>::value;
+    }
+
+    // trivially copyable small iterators are copied and moved with a memcpy of the buffer
+    // and are not destructed, without any indirect call.
+    template<typename Iter>
+    constexpr static bool is_trivial()
     {
-        return size <= sizeof(void*);
+        return is_small<Iter>() && std::is_trivially_copyable<Iter>::value;
     }
 
+    // pointer sized iterators which are equal if their bytes are equal, compared without an indirect call.
+    // Not used with tyti::count_stats, so all comparisons are counted.
     template<typename Iter>
-    inline static constexpr void* get_voidp(void** _ptr)
+    constexpr static bool is_bitwise()
+    {
+        return is_trivial<Iter>() && sizeof(Iter) == sizeof(std::uintptr_t) && is_bitwise_comparable<Iter>::value;
+    }
+
+    inline static std::uintptr_t word(const void* _storage)
     {
-        return is_small(sizeof(Iter)) ? static_cast<void*>(_ptr) : *_ptr;
+        std::uintptr_t w;
+        std::memcpy(&w, _storage, sizeof(w));
+        return w;
     }
+
+    // instrumentation, see tyti::count_stats. Compiled out without the option.
     template<typename Iter>
-    inline static constexpr const void* get_voidp(const void** _ptr)
+    static iterator_stats* stats()
+    {
+        static iterator_stats s(detail::stats_type_name<Iter>(), sizeof(Iter), !is_small<Iter>(), getFunctionInfos<Iter>());
+        return &s;
+    }
+
+    inline static void count(const TypeInfos* _ti, iterator_stats::counter iterator_stats::* _counter)
     {
-        return is_small(sizeof(Iter)) ? static_cast<const void*>(_ptr): *_ptr;
+        if (count_stats_t::value)
+            (_ti->stats_fn()->*_counter).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template<typename Iter>
+    inline static void count(iterator_stats::counter iterator_stats::* _counter)
+    {
+        if (count_stats_t::value)
+            count(getFunctionInfos<Iter>(), _counter);
+    }
+
+    // counts type switches and heap to heap reassignments (_copy) of *this
+    inline void count_assign(const TypeInfos* _newType, bool _copy) const
+    {
+        if (!count_stats_t::value || ti_ == getFunctionInfos<NoDestruct>() || _newType == getFunctionInfos<NoDestruct>())
+            return;
+        if (ti_ != _newType)
+            count(_newType, &iterator_stats::type_switches);
+        if (_copy && ti_->stats_fn()->heap && _newType->stats_fn()->heap)
+            count(_newType, &iterator_stats::reallocations);
+    }
+
+    // true if both tables belong to the same wrapped type. The tables of a type are equal
+    // unless they were instantiated in different shared libraries, see type_key
+    inline static bool same_type(const TypeInfos* _lhs, const TypeInfos* _rhs)
+    {
+        return _lhs == _rhs || _lhs->key->same_type(*_rhs->key);
+    }
+
+    inline static void destroy(const TypeInfos* _ti, void* _dst, const allocator_type& _alloc)
+    {
+        if (_ti->dtor_fn)
+            _ti->dtor_fn(_dst, _alloc);
+    }
+
+    inline static void copy(const TypeInfos* _ti, void* _dst, const void* _src, const allocator_type& _alloc)
+    {
+        count(_ti, &iterator_stats::copies);
+        if (_ti->copy_ctor_fn)
+            _ti->copy_ctor_fn(_dst, _src, _alloc);
+        else
+            std::memcpy(_dst, _src, buffer_t::size);
+    }
+
+    // compares two iterators of the type _ti
+    inline static bool equals(const TypeInfos* _ti, const void* _lhs, const void* _rhs)
+    {
+        return _ti->equal_fn ? _ti->equal_fn(_lhs, _rhs) : word(_lhs) == word(_rhs);
+    }
+
+    // moves _src into _dst, _src is destructed afterwards
+    inline static void relocate(const TypeInfos* _ti, void* _dst, void* _src)
+    {
+        count(_ti, &iterator_stats::moves);
+        if (_ti->move_ctor_fn)
+            _ti->move_ctor_fn(_dst, _src);
+        else
+            std::memcpy(_dst, _src, buffer_t::size);
+    }
+
+    template<typename Iter>
+    inline static Iter* get_iter(void* _storage)
+    {
+        return reinterpret_cast<Iter*>(is_small<Iter>() ? _storage : *reinterpret_cast<void**>(_storage));
+    }
+    template<typename Iter>
+    inline static const Iter* get_iter(const void* _storage)
+    {
+        return reinterpret_cast<const Iter*>(is_small<Iter>() ? _storage : *reinterpret_cast<void* const*>(_storage));
     }
 
     // wrapper functions for calling the memberfunction of the wrapped iterator
     template<typename Iter>
     static void inc(void* _ptr)
     {
-        ++(*reinterpret_cast<Iter*>(get_voidp<Iter>(&_ptr)));
+        count<Iter>(&iterator_stats::inc);
+        ++(*get_iter<Iter>(_ptr));
     }
 
     template<typename Iter>
     static void dec(void* _ptr)
     {
-        --(*reinterpret_cast<Iter*>(get_voidp<Iter>(&_ptr)));
+        count<Iter>(&iterator_stats::dec);
+        --(*get_iter<Iter>(_ptr));
     }
 
     template<typename Iter>
-    static const T* deref(const void* _ptr)
+    static block_type deref(const void* _ptr)
     {
-        return &(*(*reinterpret_cast<const Iter*>(get_voidp<Iter>(&_ptr))));
+        count<Iter>(&iterator_stats::deref);
+        return to_block(*(*get_iter<Iter>(_ptr)), by_value_t());
     }
 
     template<typename Iter>
-    static const bool equal(const void* _lhs, const void* _rhs)
+    static void assign_value(void* _ptr, const value_type& _value)
     {
-        return *reinterpret_cast<const Iter*>(get_voidp<Iter>(&_lhs)) == *reinterpret_cast<const Iter*>(get_voidp<Iter>(&_rhs));
+        count<Iter>(&iterator_stats::assign);
+        *(*get_iter<Iter>(_ptr)) = _value;
     }
+
     template<typename Iter>
-    static void dtor(void* _ptr)
+    static bool equal(const void* _lhs, const void* _rhs)
     {
-        reinterpret_cast<Iter*>(get_voidp<Iter>(&_ptr))->~Iter();
+        count<Iter>(&iterator_stats::equal);
+        return *get_iter<Iter>(_lhs) == *get_iter<Iter>(_rhs);
     }
+
+    // stores the addresses of up to _max elements in _out and advances _ptr behind them.
+    // The whole loop runs on the native iterator.
     template<typename Iter>
-    static void copyConstructor(void** _dst, const void* _src)
+    static std::size_t next_block(void* _ptr, const void* _end, block_type* _out, std::size_t _max)
     {
-        new (is_small(sizeof(Iter)) ? _dst : *_dst) Iter(*reinterpret_cast<const Iter*>(get_voidp<Iter>(&_src)));
+        count<Iter>(&iterator_stats::next_block);
+        Iter& it = *get_iter<Iter>(_ptr);
+        const Iter& end = *get_iter<Iter>(_end);
+        std::size_t n = 0;
+        for (; n < _max && it != end; ++it, ++n)
+            _out[n] = to_block(*it, by_value_t());
+        return n;
     }
+
+    // advances _ptr by up to _n elements, stops at _end. Returns the number of skipped elements.
+    // Uses the random access operators of the wrapped iterator when available, even if the
+    // category of the any_iterator is weaker.
     template<typename Iter>
-    static void moveConstructor(void** _dst, const void* _src)
+    static std::size_t skip(void* _ptr, const void* _end, std::size_t _n)
     {
-        new (is_small(sizeof(Iter))?_dst:*_dst) Iter(std::move(*reinterpret_cast<const Iter*>(get_voidp<Iter>(&_src))));
+        count<Iter>(&iterator_stats::skip);
+        return skip_impl(*get_iter<Iter>(_ptr), *get_iter<Iter>(_end), _n, detail::is_random_access_iterator<Iter>());
     }
 
-    // helper functions
-    inline void destruct()
+    template<typename Iter>
+    static std::size_t skip_impl(Iter& _it, const Iter& _end, std::size_t _n, std::true_type)
     {
-        ti_->dtor_fn(ptr_);
+        const std::size_t n = std::min(_n, static_cast<std::size_t>(_end - _it));
+        _it += static_cast<std::ptrdiff_t>(n);
+        return n;
     }
 
-    void switch_type(const TypeInfos* _newType)
+    template<typename Iter>
+    static std::size_t skip_impl(Iter& _it, const Iter& _end, std::size_t _n, std::false_type)
     {
-        destruct();
+        std::size_t n = 0;
+        for (; n < _n && _it != _end; ++_it, ++n) {}
+        return n;
+    }
+
+    // calls the visitor with the native iterators, the result is constructed in _result
+    template<typename Iter, typename Visitor>
+    static void visit_entry(void* _first, const void* _last, void* _visitor, void* _result)
+    {
+        count<Iter>(&iterator_stats::visit);
+        call_visitor(*static_cast<Visitor*>(_visitor), *get_iter<Iter>(_first), *get_iter<Iter>(_last), _result,
+            std::is_void<typename detail::visitor_result<Visitor>::type>());
+    }
 
-        //manage memory if type sizes are different
-        if (ti_->size < _newType->size)
+    template<typename Visitor, typename Iter>
+    static void call_visitor(Visitor& _visitor, Iter& _first, const Iter& _last, void*, std::true_type)
+    {
+        _visitor(_first, _last);
+    }
+
+    template<typename Visitor, typename Iter>
+    static void call_visitor(Visitor& _visitor, Iter& _first, const Iter& _last, void* _result, std::false_type)
+    {
+        ::new (_result) typename detail::visitor_result<Visitor>::type(_visitor(_first, _last));
+    }
+
+    template<typename Iter>
+    static value_type accumulate(const void* _first, const void* _last, value_type _init)
+    {
+        count<Iter>(&iterator_stats::accumulate);
+        Iter it = *get_iter<Iter>(_first);
+        const Iter& end = *get_iter<Iter>(_last);
+        for (; it != end; ++it)
+            _init = _init + *it;
+        return _init;
+    }
+
+    template<typename Iter>
+    static void advance(void* _ptr, std::ptrdiff_t _n)
+    {
+        count<Iter>(&iterator_stats::advance);
+        *get_iter<Iter>(_ptr) += _n;
+    }
+
+    // returns _rhs - _lhs
+    template<typename Iter>
+    static std::ptrdiff_t distance(const void* _lhs, const void* _rhs)
+    {
+        count<Iter>(&iterator_stats::distance);
+        return *get_iter<Iter>(_rhs) - *get_iter<Iter>(_lhs);
+    }
+
+    template<typename Iter>
+    static block_type subscript(const void* _ptr, std::ptrdiff_t _n)
+    {
+        count<Iter>(&iterator_stats::subscript);
+        return to_block((*get_iter<Iter>(_ptr))[_n], by_value_t());
+    }
+
+    template<typename Iter>
+    static bool less(const void* _lhs, const void* _rhs)
+    {
+        count<Iter>(&iterator_stats::less);
+        return *get_iter<Iter>(_lhs) < *get_iter<Iter>(_rhs);
+    }
+    template<typename Iter>
+    using iter_alloc = typename std::allocator_traits<allocator_type>::template rebind_alloc<Iter>;
+
+    template<typename Iter>
+    static void dtor(void* _ptr, const allocator_type& _alloc)
+    {
+        Iter* iter = get_iter<Iter>(_ptr);
+        iter->~Iter();
+        if (!is_small<Iter>())
         {
-            if ( is_small(ti_->size))
+            count<Iter>(&iterator_stats::heap_deallocations);
+            iter_alloc<Iter> alloc(_alloc);
+            std::allocator_traits<iter_alloc<Iter>>::deallocate(alloc, iter, 1);
+        }
+    }
+
+    // constructs an Iter from _src (copied or moved) in the storage _dst
+    template<typename Iter, typename Src>
+    static void construct(void* _dst, Src&& _src, const allocator_type& _alloc)
+    {
+        if (is_small<Iter>())
+        {
+            new (_dst) Iter(std::forward<Src>(_src));
+        }
+        else
+        {
+            iter_alloc<Iter> alloc(_alloc);
+            Iter* mem = std::allocator_traits<iter_alloc<Iter>>::allocate(alloc, 1);
+            count<Iter>(&iterator_stats::heap_allocations);
+            try
             {
-                my_malloc(_newType->size);
+                new (mem) Iter(std::forward<Src>(_src));
             }
-            else // old type is not small type
+            catch (...)
             {
-                if (is_small(_newType->size))
-                    std::free(ptr_);
-                else 
-                    ptr_ = std::realloc(ptr_, _newType->size);               
+                count<Iter>(&iterator_stats::heap_deallocations);
+                std::allocator_traits<iter_alloc<Iter>>::deallocate(alloc, mem, 1);
+                throw;
             }
-            if ( !check_alloc(ptr_,_newType->size)) throw std::bad_alloc();
+            *reinterpret_cast<void**>(_dst) = mem;
         }
+    }
 
+    template<typename Iter>
+    static void copyConstructor(void* _dst, const void* _src, const allocator_type& _alloc)
+    {
+        construct<Iter>(_dst, *get_iter<Iter>(_src), _alloc);
+    }
+
+    template<typename Iter>
+    static void copy_assign(void* _dst, const void* _src)
+    {
+        *get_iter<Iter>(_dst) = *get_iter<Iter>(_src);
+    }
 
+    // moves the iterator into _dst and destructs the source.
+    // Only used for small iterators, heap iterators are not touched,
+    // only the pointer is stolen (see relocate), so both sides have to use equal allocators.
+    template<typename Iter>
+    static void moveConstructor(void* _dst, void* _src)
+    {
+        Iter* src = get_iter<Iter>(_src);
+        new (_dst) Iter(std::move(*src));
+        src->~Iter();
+    }
+
+    // helper functions
+    inline void destruct()
+    {
+        destroy(ti_, storage(), this->get_alloc());
+    }
+
+    // destructs the current iterator and copies _src of type _newType into the storage
+    // if the copy throws, *this is left in an empty state.
+    // Iterators of the same type are assigned in place.
+    void assign(const TypeInfos* _newType, const void* _src)
+    {
+        this->reset_cache();
+        if (ti_ == _newType && (ti_->copy_assign_fn || !ti_->copy_ctor_fn))
+        {
+            count(_newType, &iterator_stats::copies);
+            if (ti_->copy_assign_fn)
+                ti_->copy_assign_fn(storage(), _src);
+            else
+                std::memcpy(storage(), _src, buffer_t::size);
+            return;
+        }
+        count_assign(_newType, true);
+        destruct();
+        ti_ = getFunctionInfos<NoDestruct>();
+        copy(_newType, storage(), _src, this->get_alloc());
         ti_ = _newType;
     }
 
-    template<typename IterType>
-    inline static constexpr const void* itertype_addr(const void** ptr)
+    // assigns a native iterator. An iterator of the same type is assigned in place,
+    // which keeps the heap block, otherwise the current one is destructed first.
+    template<typename Iter>
+    void assign(Iter&& _iter)
     {
-        return is_small(sizeof(IterType)) ? ptr : *ptr;
+        using IterType = typename std::decay<Iter>::type;
+        check_category<IterType>();
+        this->reset_cache();
+        if (ti_ == getFunctionInfos<IterType>())
+            assign_same(std::forward<Iter>(_iter), std::is_assignable<IterType&, Iter&&>());
+        else
+            assign_other(std::forward<Iter>(_iter));
     }
 
-    inline void copy_and_assign(const void* _src)
+    template<typename Iter>
+    void assign_same(Iter&& _iter, std::true_type)
     {
-        ti_->copy_ctor_fn(&ptr_, _src);
+        *get_iter<typename std::decay<Iter>::type>(storage()) = std::forward<Iter>(_iter);
     }
 
-    inline void move_iter(const void* _src)
+    // e.g. iterators holding a lambda
+    template<typename Iter>
+    void assign_same(Iter&& _iter, std::false_type)
     {
-        ti_->move_ctor_fn(&ptr_, _src);
+        assign_other(std::forward<Iter>(_iter));
     }
 
-    inline static void* my_malloc(size_t size)
+    template<typename Iter>
+    void assign_other(Iter&& _iter)
     {
-        return (is_small(size)) ? 0 : malloc(size);
+        using IterType = typename std::decay<Iter>::type;
+        count_assign(getFunctionInfos<IterType>(), true);
+        destruct();
+        ti_ = getFunctionInfos<NoDestruct>();
+        construct<IterType>(storage(), std::forward<Iter>(_iter), this->get_alloc());
+        ti_ = getFunctionInfos<IterType>();
+    }
+
+    inline void* storage() { return &buffer_; }
+    inline const void* storage() const { return &buffer_; }
+
+    // result of the dereference of output iterators
+    class output_proxy
+    {
+        void* storage_;
+        assign_t assign_fn_;
+
+    public:
+        output_proxy(void* _storage, assign_t _assign_fn) : storage_(_storage), assign_fn_(_assign_fn) {}
+
+        const output_proxy& operator=(const value_type& _value) const
+        {
+            assign_fn_(storage_, _value);
+            return *this;
+        }
+    };
+
+    reference deref_impl(std::input_iterator_tag) const
+    {
+        return from_block(deref_block(cache_deref_t()));
+    }
+
+    block_type deref_block(std::false_type) const
+    {
+        return ti_.deref(storage());
     }
 
-    inline static constexpr bool check_alloc(void* ptr, size_t size)
+    // see tyti::cache_deref
+    block_type deref_block(std::true_type) const
     {
-        return (is_small(size)) ? true : ptr != nullptr;
+        if (const block_type* cached = this->cached())
+            return *cached;
+        if (!ti_->pure_deref)
+            return ti_.deref(storage());
+        return this->cache(ti_.deref(storage()));
+    }
+
+    output_proxy deref_impl(std::output_iterator_tag) const
+    {
+        return output_proxy(const_cast<void*>(storage()), ti_->assign_fn);
+    }
+
+    // result of post-increment of input iterators, keeps the value for *it++
+    class postinc_proxy
+    {
+        value_type value_;
+    public:
+        explicit postinc_proxy(value_type&& _value) : value_(std::move(_value)) {}
+        const value_type& operator*() const { return value_; }
+    };
+
+    any_iterator post_increment(std::forward_iterator_tag) {
+        any_iterator cpy(*this);
+        ++*this;
+        return cpy;
+    }
+
+    postinc_proxy post_increment(std::input_iterator_tag) {
+        postinc_proxy cpy(value_type(**this));
+        ++*this;
+        return cpy;
+    }
+
+    // output iterators do not change on increment
+    any_iterator& post_increment(std::output_iterator_tag) {
+        ti_.inc(storage());
+        return *this;
+    }
+
+    // copies the iterator of type _ti stored in _src, used by any_range
+    any_iterator(const TypeInfos* _ti, const void* _src, const allocator_type& _alloc)
+        : alloc_base(_alloc), ti_(getFunctionInfos<NoDestruct>())
+    {
+        copy(_ti, storage(), _src, this->get_alloc());
+        ti_ = _ti;
     }
 
     // member variables
-    void* ptr_;
-    const TypeInfos* ti_;
+    alignas(buffer_t::align) unsigned char buffer_[buffer_t::size];
+    table_t ti_;
+
+    friend class any_range<T, Options...>;
+    friend class any_sentinel<T, Options...>;
+    template<typename U, typename... Os, typename F>
+    friend typename detail::visitor_result<typename std::remove_reference<F>::type>::type
+        visit(any_iterator<U, Os...>& _first, const any_iterator<U, Os...>& _last, F&& _f);
 
     /// Interface
 public:
-    template <typename IterType, class = typename std::enable_if<!std::is_rvalue_reference<IterType>::value>::type>
-    explicit any_iterator(const IterType& _iter) 
-        : ptr_(my_malloc(sizeof(IterType))), ti_(getFunctionInfos<IterType>())
+    /// empty any_iterator (value-initialized iterator), can be assigned, destructed
+    /// and compared to other empty any_iterators
+    any_iterator()
+        : alloc_base(), ti_(getFunctionInfos<NoDestruct>())
     {
-        if (!check_alloc(ptr_, sizeof(IterType))) throw std::bad_alloc();
-        auto ptr = reinterpret_cast<const void*>(&_iter);
-        copy_and_assign(itertype_addr<IterType>(&ptr));
     }
 
-    template<typename IterType, class = typename std::enable_if<std::is_rvalue_reference<IterType>::value>::type>
-        explicit any_iterator(IterType&& _iter)
-        : ptr_(my_malloc(_iter.ti_->size)), ti_(std::move(_iter.ti_))
+    /// wraps a copy of _iter, rvalues are moved into the any_iterator
+    template<typename Iter, class = typename std::enable_if<!std::is_same<typename std::decay<Iter>::type, any_iterator>::value>::type>
+    explicit any_iterator(Iter&& _iter, const allocator_type& _alloc = allocator_type())
+        : alloc_base(_alloc), ti_(getFunctionInfos<NoDestruct>())
     {
-        if ( !check_alloc(ptr_,_iter.ti_->size)) throw std::bad_alloc();
-        move_iter(_iter);
+        using IterType = typename std::decay<Iter>::type;
+        check_category<IterType>();
+        construct<IterType>(storage(), std::forward<Iter>(_iter), this->get_alloc());
+        ti_ = getFunctionInfos<IterType>();
     }
 
     any_iterator(const any_iterator& _iter)
-        : ptr_(my_malloc(_iter.ti_->size)), ti_(_iter.ti_)
+        : alloc_base(std::allocator_traits<allocator_type>::select_on_container_copy_construction(_iter.get_alloc())),
+        cache_base(), ti_(getFunctionInfos<NoDestruct>())
     {
-        if ( !check_alloc(ptr_,_iter.ti_->size)) throw std::bad_alloc();
-        copy_and_assign(_iter.ptr_);
+        copy(_iter.ti_, storage(), _iter.storage(), this->get_alloc());
+        ti_ = _iter.ti_;
     }
 
-    any_iterator(any_iterator&& _iter)
-        :ptr_(_iter.ptr_), ti_(_iter.ti_)
+    any_iterator(any_iterator&& _iter) noexcept
+        : alloc_base(_iter.get_alloc()), ti_(_iter.ti_)
     {
+        relocate(ti_, storage(), _iter.storage());
         _iter.ti_ = getFunctionInfos<NoDestruct>();
     }
 
-    template <typename IterType, class = typename std::enable_if<!std::is_rvalue_reference<IterType>::value>::type >
-    const any_iterator& operator=(const IterType& _iter)
+    /// assigns a copy of _iter, rvalues are moved. Iterators of the currently wrapped type
+    /// are assigned in place, without reallocation of heap stored iterators.
+    template<typename Iter, class = typename std::enable_if<!std::is_same<typename std::decay<Iter>::type, any_iterator>::value>::type>
+    const any_iterator& operator=(Iter&& _iter)
     {
-        switch_type(getFunctionInfos<IterType>());
-        auto ptr = reinterpret_cast<const void*>(&_iter);
-        copy_and_assign(itertype_addr<IterType>(&ptr));
+        assign(std::forward<Iter>(_iter));
         return *this;
     }
 
-    template <typename IterType, class = typename std::enable_if<std::is_rvalue_reference<IterType>::value>::type>
-        const any_iterator& operator=(IterType&& _iter)
+    const any_iterator& operator=(const any_iterator& _iter)
     {
-        switch_type(getFunctionInfos<IterType>());
-        auto ptr = reinterpret_cast<const void*>(&_iter);
-        move_iter(itertype_addr<IterType>(&ptr));
+        if (this != &_iter)
+            assign(_iter.ti_, _iter.storage());
         return *this;
     }
 
-    const any_iterator& operator=(const any_iterator& _iter)
+    // stealing the heap block is only possible with equal allocators, otherwise it is copied
+    const any_iterator& operator=(any_iterator&& _iter) noexcept(std::allocator_traits<allocator_type>::is_always_equal::value)
     {
-        switch_type(_iter.ti_);
-        copy_and_assign(_iter.ptr_);
+        if (this != &_iter)
+        {
+            if (!this->equal_alloc(_iter))
+                return operator=(static_cast<const any_iterator&>(_iter));
+            this->reset_cache();
+            count_assign(_iter.ti_, false);
+            destruct();
+            ti_ = _iter.ti_;
+            relocate(ti_, storage(), _iter.storage());
+            _iter.ti_ = getFunctionInfos<NoDestruct>();
+        }
         return *this;
     }
 
-    const any_iterator& operator=(any_iterator&& _iter)
+    ~any_iterator()
     {
-        std::swap(ti_, _iter.ti_);
-        std::swap(ptr_, _iter.ptr_);
-        //old ptr gets destructed via _iter
-        return *this;
+        destruct();
     }
 
-    ~any_iterator() 
+    allocator_type get_allocator() const
     {
-        destruct();
-        if (!is_small(ti_->size))
-            std::free(ptr_);
+        return this->get_alloc();
+    }
+
+    /// identity of the wrapped type, e.g. as key of caches per wrapped type (see type_key::id)
+    const type_key& wrapped_type() const
+    {
+        return *ti_->key;
     }
 
     bool operator==(const any_iterator& _rhs) const
     {
-        if (ti_ != _rhs.ti_) //different types
+        static_assert(!is_output, "output any_iterators are not comparable");
+        if (!same_type(ti_, _rhs.ti_)) //different types
             return false;
-        return ti_->equal_fn(ptr_, _rhs.ptr_);
+        return ti_.equal(storage(), _rhs.storage());
+    }
+
+    bool operator!=(const any_iterator& _rhs) const
+    {
+        return !operator==(_rhs);
     }
 
+    // comparison with the native iterator. The wrapped iterator must be of type IterType.
     template <typename IterType>
     bool operator==(const IterType& _rhs) const {
-        auto ptr = reinterpret_cast<const void*>(&_rhs);
-        return ti_->equal_fn(ptr_, itertype_addr<IterType>(&ptr));
+        assert(same_type(ti_, getFunctionInfos<IterType>()));
+        return *get_iter<IterType>(storage()) == _rhs;
     }
 
     template <typename IterType>
@@ -277,50 +1368,199 @@ public:
 
     /// Standard pre-increment operator
     any_iterator& operator++() {
-        ti_->inc_fn(ptr_);
+        this->reset_cache();
+        ti_.inc(storage());
         return *this;
     }
 
-    /// Standard post-increment operator
-    any_iterator operator++(int) {
-        any_iterator cpy(*this);
-        ti_->inc_fn(ptr_);
-        return cpy;
+    /// Standard post-increment operator.
+    /// Returns a copy, which is a memcpy for small trivially copyable iterators.
+    /// Input any_iterators return a postinc_proxy with the current value instead (enough for *it++).
+    auto operator++(int) -> decltype(this->post_increment(category_t())) {
+        return post_increment(category_t());
     }
 
     /// Standard pre-decrement operator
     any_iterator& operator--() {
-        ti_->dec_fn(ptr_);
+        static_assert(is_bidirectional, "decrement requires a bidirectional any_iterator");
+        this->reset_cache();
+        ti_->dec_fn(storage());
         return *this;
     }
 
     /// Standard post-decrement operator
     any_iterator operator--(int) {
+        static_assert(is_bidirectional, "decrement requires a bidirectional any_iterator");
         any_iterator cpy(*this);
-        ti_->dec_fn(ptr_);
+        --*this;
         return cpy;
     }
 
-    const T& operator*() const {
-        return *(ti_->deref_fn(ptr_));
+    /// Random access operators, O(1) when the category is random access
+    any_iterator& operator+=(std::ptrdiff_t _n) {
+        static_assert(is_random_access, "operator+= requires a random access any_iterator");
+        this->reset_cache();
+        ti_->advance_fn(storage(), _n);
+        return *this;
+    }
+
+    any_iterator& operator-=(std::ptrdiff_t _n) {
+        return operator+=(-_n);
+    }
+
+    any_iterator operator+(std::ptrdiff_t _n) const {
+        any_iterator cpy(*this);
+        cpy += _n;
+        return cpy;
+    }
+
+    friend any_iterator operator+(std::ptrdiff_t _n, const any_iterator& _iter) {
+        return _iter + _n;
+    }
+
+    any_iterator operator-(std::ptrdiff_t _n) const {
+        return operator+(-_n);
+    }
+
+    // both iterators have to wrap the same type
+    std::ptrdiff_t operator-(const any_iterator& _rhs) const {
+        static_assert(is_random_access, "operator- requires a random access any_iterator");
+        assert(same_type(ti_, _rhs.ti_));
+        return ti_->distance_fn(_rhs.storage(), storage());
+    }
+
+    reference operator[](std::ptrdiff_t _n) const {
+        static_assert(is_random_access, "operator[] requires a random access any_iterator");
+        return from_block(ti_->subscript_fn(storage(), _n));
+    }
+
+    bool operator<(const any_iterator& _rhs) const {
+        static_assert(is_random_access, "operator< requires a random access any_iterator");
+        assert(same_type(ti_, _rhs.ti_));
+        return ti_->less_fn(storage(), _rhs.storage());
+    }
+
+    /// Stores the addresses (or values, see tyti::by_value) of the next (up to) _max elements in _out
+    /// and advances the iterator behind them. Returns the number of stored elements,
+    /// 0 when _last is reached. Costs one indirect call per block instead of three per element.
+    /// Use from_block to get the reference of an element.
+    /// Requires a forward any_iterator, _last has to wrap the same type.
+    std::size_t next_block(const any_iterator& _last, block_type* _out, std::size_t _max) {
+        static_assert(is_forward, "next_block requires a forward any_iterator");
+        assert(same_type(ti_, _last.ti_));
+        this->reset_cache();
+        return ti_->next_block_fn(storage(), _last.storage(), _out, _max);
+    }
+
+    bool operator>(const any_iterator& _rhs) const {
+        return _rhs < *this;
+    }
+
+    bool operator<=(const any_iterator& _rhs) const {
+        return !(_rhs < *this);
+    }
+
+    bool operator>=(const any_iterator& _rhs) const {
+        return !(*this < _rhs);
+    }
+
+    /// Standard dereference operator.
+    /// Returns an output_proxy for output any_iterators, so *it = value writes through the wrapped iterator.
+    auto operator*() const -> decltype(this->deref_impl(category_t())) {
+        return deref_impl(category_t());
     }
 
     /// Standard pointer operator.
-    const T* operator->() const {
-        return ti_->deref_fn(ptr_);
+    pointer operator->() const {
+        static_assert(!is_output, "operator-> requires an input any_iterator");
+        return to_pointer(deref_block(cache_deref_t()), by_value_t());
     }
 };
 
-} // end namespace tyti
+/// End of a range of any_iterators for the loop condition, e.g.
+///     for (const any_sentinel<int> end(last); it != end; ++it)
+/// Keeps the comparison of the wrapped type next to the end position: bitwise comparable iterators
+/// (see is_bitwise_comparable) are compared with the stored word inline, all others through the
+/// stored entry of the function table, without loading the table first.
+template<typename T, typename... Options>
+class any_sentinel
+{
+    using iterator = any_iterator<T, Options...>;
+    using TypeInfos = typename iterator::TypeInfos;
+    using equal_t = typename iterator::equal_t;
 
-template<typename IterT, typename T>
-bool operator==(const IterT&& _lhs, const tyti::any_iterator<T>&& _rhs)
+    iterator end_;
+    const TypeInfos* ti_;
+    equal_t equal_fn_;
+    std::uintptr_t word_;
+
+public:
+    explicit any_sentinel(const iterator& _end)
+        : end_(_end), ti_(end_.ti_), equal_fn_(ti_->equal_fn), word_(equal_fn_ ? 0 : iterator::word(end_.storage()))
+    {
+        static_assert(std::is_base_of<std::input_iterator_tag, typename iterator::iterator_category>::value,
+            "output any_iterators are not comparable");
+    }
+
+    /// the end position as any_iterator
+    const iterator& base() const { return end_; }
+
+    friend bool operator==(const iterator& _it, const any_sentinel& _end) { return _end.is_end(_it); }
+    friend bool operator==(const any_sentinel& _end, const iterator& _it) { return _end.is_end(_it); }
+    friend bool operator!=(const iterator& _it, const any_sentinel& _end) { return !_end.is_end(_it); }
+    friend bool operator!=(const any_sentinel& _end, const iterator& _it) { return !_end.is_end(_it); }
+
+private:
+    bool is_end(const iterator& _it) const
+    {
+        if (!iterator::same_type(_it.ti_, ti_))
+            return false;
+        return equal_fn_ ? equal_fn_(_it.storage(), end_.storage()) : iterator::word(_it.storage()) == word_;
+    }
+};
+
+/// Applies _f to every element in [_first, _last).
+/// The range is traversed blockwise, see any_iterator::next_block.
+template<typename T, typename... Options, typename F>
+F for_each(any_iterator<T, Options...> _first, const any_iterator<T, Options...>& _last, F _f)
+{
+    using category = typename std::iterator_traits<any_iterator<T, Options...>>::iterator_category;
+    return detail::for_each_blockwise(_first, _last, std::move(_f), category());
+}
+
+/// Recovers the wrapped type once and calls _f(first, last) with references to the native iterators,
+/// so the loop inside of _f is compiled for the concrete type (inlined, vectorized).
+/// The type of _f has to be registered with the tyti::visitors option of the any_iterator.
+/// _first and _last have to wrap the same type, _first may be advanced by _f.
+template<typename T, typename... Options, typename F>
+typename detail::visitor_result<typename std::remove_reference<F>::type>::type
+visit(any_iterator<T, Options...>& _first, const any_iterator<T, Options...>& _last, F&& _f)
+{
+    using iterator = any_iterator<T, Options...>;
+    using visitor = typename std::remove_reference<F>::type;
+    using result = typename detail::visitor_result<visitor>::type;
+    static_assert(!std::is_const<visitor>::value, "visitors are called as non-const lvalues");
+    static_assert(detail::visitor_index<visitor, typename iterator::visitors_t>::value
+        < std::tuple_size<typename iterator::visit_table_t>::value,
+        "the visitor is not registered, add it to the tyti::visitors option of the any_iterator");
+    assert(iterator::same_type(_first.ti_, _last.ti_) && "tyti::visit requires iterators of the same wrapped type");
+    const auto fn = _first.ti_->visit_fns[detail::visitor_index<visitor, typename iterator::visitors_t>::value];
+    assert(fn && "tyti::visit on an empty any_iterator");
+    _first.reset_cache();
+    return detail::call_visit_entry<result>(fn, _first.storage(), _last.storage(), &_f, std::is_void<result>());
+}
+
+// comparison of a native iterator with an any_iterator wrapping it
+template<typename IterT, typename T, typename... Options, class = typename std::enable_if<detail::is_native_iterator<IterT>::value>::type>
+bool operator==(const IterT& _lhs, const any_iterator<T, Options...>& _rhs)
 {
-    return _rhs.operator==(std::forward<IterT>(_lhs));
+    return _rhs.operator==(_lhs);
 }
 
-template<typename IterT, typename T>
-bool operator!=(IterT&& _lhs, tyti::any_iterator<T>&& _rhs)
+template<typename IterT, typename T, typename... Options, class = typename std::enable_if<detail::is_native_iterator<IterT>::value>::type>
+bool operator!=(const IterT& _lhs, const any_iterator<T, Options...>& _rhs)
 {
-    return _rhs.operator!=(std::forward<IterT>(_lhs));
+    return _rhs.operator!=(_lhs);
 }
+
+} // end namespace tyti
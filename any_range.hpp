@@ -0,0 +1,309 @@
+#pragma once
+
+#include "any_iterator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tyti {
+
+template<typename T, typename... Options>
+class any_chain;
+
+/// Range of two iterators of the same type with run-time polymorphism.
+/// In contrast to a pair of any_iterators, the type is stored once and
+/// the algorithms below dispatch once per range (or per block of elements)
+/// instead of several times per element.
+/// Requires a forward any_iterator (the default category is bidirectional).
+template<typename T, typename... Options>
+class any_range : private detail::allocator_holder<typename any_iterator<T, Options...>::allocator_type>
+{
+public:
+    using iterator = any_iterator<T, Options...>;
+    using const_iterator = iterator;
+    using value_type = typename iterator::value_type;
+    using reference = typename iterator::reference;
+    using pointer = typename iterator::pointer;
+    using allocator_type = typename iterator::allocator_type;
+
+private:
+    using block_type = typename iterator::block_type;
+    using alloc_base = detail::allocator_holder<allocator_type>;
+    using TypeInfos = typename iterator::TypeInfos;
+    using NoDestruct = typename iterator::NoDestruct;
+    using buffer_t = typename iterator::buffer_t;
+
+    static_assert(std::is_base_of<std::forward_iterator_tag, typename iterator::category_t>::value,
+        "any_range requires a forward any_iterator");
+
+    inline void destruct()
+    {
+        iterator::destroy(ti_, &first_, this->get_alloc());
+        iterator::destroy(ti_, &last_, this->get_alloc());
+    }
+
+    // copies the iterators stored in _first and _last of type _ti.
+    // if a copy throws, *this is left in an empty state
+    void copy_from(const TypeInfos* _ti, const void* _first, const void* _last)
+    {
+        ti_ = iterator::template getFunctionInfos<NoDestruct>();
+        iterator::copy(_ti, &first_, _first, this->get_alloc());
+        try
+        {
+            iterator::copy(_ti, &last_, _last, this->get_alloc());
+        }
+        catch (...)
+        {
+            iterator::destroy(_ti, &first_, this->get_alloc());
+            throw;
+        }
+        ti_ = _ti;
+    }
+
+    template<typename IterType>
+    void construct(IterType&& _first, IterType&& _last)
+    {
+        iterator::template check_category<IterType>();
+        ti_ = iterator::template getFunctionInfos<NoDestruct>();
+        iterator::template construct<IterType>(&first_, std::move(_first), this->get_alloc());
+        try
+        {
+            iterator::template construct<IterType>(&last_, std::move(_last), this->get_alloc());
+        }
+        catch (...)
+        {
+            iterator::destroy(iterator::template getFunctionInfos<IterType>(), &first_, this->get_alloc());
+            throw;
+        }
+        ti_ = iterator::template getFunctionInfos<IterType>();
+    }
+
+    // calls _f(block, n) for every block of elements
+    template<typename F>
+    void for_each_block(F&& _f) const
+    {
+        iterator it = begin();
+        block_type block[detail::block_size];
+        while (const std::size_t n = ti_->next_block_fn(it.storage(), &last_, block, detail::block_size))
+        {
+            if (!_f(block, n))
+                return;
+        }
+    }
+
+    // copies the iterators of type _ti stored in _first and _last, used by split
+    any_range(const TypeInfos* _ti, const void* _first, const void* _last, const allocator_type& _alloc)
+        : alloc_base(_alloc)
+    {
+        copy_from(_ti, _first, _last);
+    }
+
+    // used by the iterators of any_chain, _it has to wrap the type of the range
+    bool is_first(const iterator& _it) const { return iterator::equals(ti_, _it.storage(), &first_); }
+    bool is_last(const iterator& _it) const { return iterator::equals(ti_, _it.storage(), &last_); }
+    // assigns in place when _it wraps the type of the range already
+    void assign_first(iterator& _it) const { _it.assign(ti_, &first_); }
+    void assign_last(iterator& _it) const { _it.assign(ti_, &last_); }
+
+    template<typename U, typename... Os>
+    friend class any_chain;
+
+    // member variables
+    alignas(buffer_t::align) unsigned char first_[buffer_t::size];
+    alignas(buffer_t::align) unsigned char last_[buffer_t::size];
+    const TypeInfos* ti_;
+
+    /// Interface
+public:
+    /// the iterators are moved into the range
+    template<typename IterType>
+    any_range(IterType _first, IterType _last, const allocator_type& _alloc = allocator_type())
+        : alloc_base(_alloc)
+    {
+        construct(std::move(_first), std::move(_last));
+    }
+
+    /// constructs the range from two any_iterators which wrap the same type
+    any_range(const iterator& _first, const iterator& _last)
+        : alloc_base(_first.get_allocator())
+    {
+        assert(iterator::same_type(_first.ti_, _last.ti_));
+        copy_from(_first.ti_, _first.storage(), _last.storage());
+    }
+
+    any_range(const any_range& _rhs)
+        : alloc_base(std::allocator_traits<allocator_type>::select_on_container_copy_construction(_rhs.get_alloc()))
+    {
+        copy_from(_rhs.ti_, &_rhs.first_, &_rhs.last_);
+    }
+
+    any_range(any_range&& _rhs) noexcept
+        : alloc_base(_rhs.get_alloc()), ti_(_rhs.ti_)
+    {
+        iterator::relocate(ti_, &first_, &_rhs.first_);
+        iterator::relocate(ti_, &last_, &_rhs.last_);
+        _rhs.ti_ = iterator::template getFunctionInfos<NoDestruct>();
+    }
+
+    const any_range& operator=(const any_range& _rhs)
+    {
+        if (this != &_rhs)
+        {
+            destruct();
+            copy_from(_rhs.ti_, &_rhs.first_, &_rhs.last_);
+        }
+        return *this;
+    }
+
+    const any_range& operator=(any_range&& _rhs) noexcept(std::allocator_traits<allocator_type>::is_always_equal::value)
+    {
+        if (this != &_rhs)
+        {
+            if (!this->equal_alloc(_rhs))
+                return operator=(static_cast<const any_range&>(_rhs));
+            destruct();
+            ti_ = _rhs.ti_;
+            iterator::relocate(ti_, &first_, &_rhs.first_);
+            iterator::relocate(ti_, &last_, &_rhs.last_);
+            _rhs.ti_ = iterator::template getFunctionInfos<NoDestruct>();
+        }
+        return *this;
+    }
+
+    ~any_range()
+    {
+        destruct();
+    }
+
+    iterator begin() const { return iterator(ti_, &first_, this->get_alloc()); }
+    iterator end() const { return iterator(ti_, &last_, this->get_alloc()); }
+
+    allocator_type get_allocator() const { return this->get_alloc(); }
+
+    bool empty() const { return iterator::equals(ti_, &first_, &last_); }
+
+    /// Number of elements. O(1) for random access wrapped iterators (independent of the
+    /// category of the any_iterator), otherwise one pass over the range on the native iterator.
+    std::size_t size() const
+    {
+        iterator it = begin();
+        return ti_->skip_fn(it.storage(), &last_, static_cast<std::size_t>(-1));
+    }
+
+    /// Splits the range into up to _parts consecutive subranges of (almost) equal size,
+    /// e.g. to process them in parallel, see parallel.hpp.
+    /// O(_parts) for random access wrapped iterators. Otherwise the range is pre-scanned:
+    /// one native pass to count the elements and one to find the boundaries.
+    std::vector<any_range> split(std::size_t _parts) const
+    {
+        assert(_parts > 0);
+        std::vector<any_range> result;
+        const std::size_t n = size();
+        if (n == 0)
+            return result;
+        const std::size_t parts = std::min(_parts, n);
+        result.reserve(parts);
+        iterator first = begin();
+        for (std::size_t i = 0; i < parts; ++i)
+        {
+            // the remainder is spread over the first parts
+            const std::size_t len = n / parts + (i < n % parts ? 1 : 0);
+            iterator last = first;
+            ti_->skip_fn(last.storage(), &last_, len);
+            result.push_back(any_range(ti_, first.storage(), last.storage(), this->get_alloc()));
+            first = std::move(last);
+        }
+        return result;
+    }
+
+    /// Applies _f to every element. The loop over a block of elements is inlined.
+    template<typename F>
+    F for_each(F _f) const
+    {
+        for_each_block([&_f](block_type* _block, std::size_t _n)
+        {
+            for (std::size_t i = 0; i < _n; ++i)
+                _f(iterator::from_block(_block[i]));
+            return true;
+        });
+        return _f;
+    }
+
+    /// Sums up all elements with operator+.
+    /// The loop runs on the native iterator inside of a single indirect call.
+    value_type accumulate(value_type _init) const
+    {
+        static_assert(detail::is_addable<value_type>::value, "accumulate requires value_type + value_type");
+        return ti_->accumulate_fn(&first_, &last_, std::move(_init));
+    }
+
+    template<typename Acc, typename BinaryOp>
+    Acc accumulate(Acc _init, BinaryOp _op) const
+    {
+        for_each_block([&](block_type* _block, std::size_t _n)
+        {
+            for (std::size_t i = 0; i < _n; ++i)
+                _init = _op(std::move(_init), iterator::from_block(_block[i]));
+            return true;
+        });
+        return _init;
+    }
+
+    /// Returns an iterator to the first element which satisfies _pred or end().
+    /// The result is positioned on the native iterator by skipping from the start of the block
+    /// of the match, so only the elements of that block in front of the match are passed twice.
+    template<typename Pred>
+    iterator find_if(Pred _pred) const
+    {
+        iterator it = begin();
+        iterator block_start = it;
+        block_type block[detail::block_size];
+        while (const std::size_t n = ti_->next_block_fn(it.storage(), &last_, block, detail::block_size))
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (_pred(iterator::from_block(block[i])))
+                {
+                    // positioned on the native iterator, like split
+                    ti_->skip_fn(block_start.storage(), &last_, i);
+                    return block_start;
+                }
+            }
+            block_start = it; // assigned in place
+        }
+        return end();
+    }
+
+    template<typename Pred>
+    std::size_t count_if(Pred _pred) const
+    {
+        std::size_t count = 0;
+        for_each_block([&](block_type* _block, std::size_t _n)
+        {
+            for (std::size_t i = 0; i < _n; ++i)
+                if (_pred(iterator::from_block(_block[i])))
+                    ++count;
+            return true;
+        });
+        return count;
+    }
+
+    template<typename OutputIt>
+    OutputIt copy(OutputIt _out) const
+    {
+        for_each_block([&](block_type* _block, std::size_t _n)
+        {
+            for (std::size_t i = 0; i < _n; ++i, ++_out)
+                *_out = iterator::from_block(_block[i]);
+            return true;
+        });
+        return _out;
+    }
+};
+
+} // end namespace tyti
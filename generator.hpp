@@ -0,0 +1,240 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || __cplusplus < 202002L
+#error "generator.hpp requires C++20 coroutines"
+#endif
+
+#include <iterator>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory> //addressof, allocator, allocator_traits
+#include <new> //placement new
+#include <type_traits>
+#include <utility>
+
+#include "any_iterator.hpp" //is_bitwise_comparable
+
+namespace tyti {
+
+template<typename T, typename Alloc>
+class generator;
+
+namespace detail {
+
+// unit of the coroutine frame allocation, aligned like operator new
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_block
+{
+    unsigned char bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+};
+
+// generator<T> yields const T&, generator<T&> yields T&
+template<typename T>
+using generator_reference = std::conditional_t<std::is_reference<T>::value, T, const T&>;
+
+template<typename T, typename Alloc>
+class generator_promise
+{
+    using Reference = generator_reference<T>;
+    using pointer = std::add_pointer_t<Reference>;
+    using block_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<frame_block>;
+    using block_traits = std::allocator_traits<block_alloc>;
+
+    // the allocator is stored behind the frame, operator delete only gets the pointer and the size
+    static constexpr std::size_t alloc_offset(std::size_t _size)
+    {
+        return (_size + alignof(block_alloc) - 1) / alignof(block_alloc) * alignof(block_alloc);
+    }
+
+    static constexpr std::size_t blocks(std::size_t _size)
+    {
+        return (alloc_offset(_size) + sizeof(block_alloc) + sizeof(frame_block) - 1) / sizeof(frame_block);
+    }
+
+    static void* allocate(std::size_t _size, const Alloc& _alloc)
+    {
+        block_alloc alloc(_alloc);
+        frame_block* frame = block_traits::allocate(alloc, blocks(_size));
+        ::new (static_cast<void*>(reinterpret_cast<unsigned char*>(frame) + alloc_offset(_size))) block_alloc(std::move(alloc));
+        return frame;
+    }
+
+public:
+    generator<T, Alloc> get_return_object() noexcept
+    {
+        return generator<T, Alloc>(std::coroutine_handle<generator_promise>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_always final_suspend() const noexcept { return {}; }
+
+    // the yielded object lives until the coroutine is resumed, temporaries included
+    std::suspend_always yield_value(Reference&& _value) noexcept
+    {
+        value_ = std::addressof(_value);
+        return {};
+    }
+
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+    // co_await is not supported inside of generators
+    template<typename U>
+    std::suspend_never await_transform(U&&) = delete;
+
+    Reference value() const noexcept { return static_cast<Reference>(*value_); }
+
+    void rethrow_if_exception()
+    {
+        if (exception_)
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+    }
+
+    // coroutines taking (std::allocator_arg, alloc, ...) allocate their frame with alloc,
+    // member coroutines pass the object first
+    template<typename... Args>
+    static void* operator new(std::size_t _size, std::allocator_arg_t, const Alloc& _alloc, const Args&...)
+    {
+        return allocate(_size, _alloc);
+    }
+
+    template<typename This, typename... Args>
+    static void* operator new(std::size_t _size, const This&, std::allocator_arg_t, const Alloc& _alloc, const Args&...)
+    {
+        return allocate(_size, _alloc);
+    }
+
+    // all others with a default constructed Alloc
+    static void* operator new(std::size_t _size)
+    {
+        return allocate(_size, Alloc());
+    }
+
+    static void operator delete(void* _frame, std::size_t _size) noexcept
+    {
+        block_alloc* stored = std::launder(reinterpret_cast<block_alloc*>(static_cast<unsigned char*>(_frame) + alloc_offset(_size)));
+        block_alloc alloc(std::move(*stored));
+        stored->~block_alloc();
+        block_traits::deallocate(alloc, static_cast<frame_block*>(_frame), blocks(_size));
+    }
+
+private:
+    pointer value_ = nullptr;
+    std::exception_ptr exception_;
+};
+
+// iterator of tyti::generator, one coroutine handle. The end iterator holds no handle.
+template<typename T, typename Alloc>
+class generator_iterator
+{
+    using Reference = generator_reference<T>;
+    using promise_type = generator_promise<T, Alloc>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    handle_type coro_;
+
+    explicit generator_iterator(handle_type _coro) noexcept : coro_(_coro) {}
+
+    friend class generator<T, Alloc>;
+
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::remove_cvref_t<Reference>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::add_pointer_t<Reference>;
+    using reference = Reference;
+
+    generator_iterator() noexcept = default;
+
+    reference operator*() const noexcept { return coro_.promise().value(); }
+    pointer operator->() const noexcept { return std::addressof(coro_.promise().value()); }
+
+    // runs the coroutine to the next co_yield, rethrows its exceptions
+    generator_iterator& operator++()
+    {
+        resume();
+        return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(const generator_iterator& _rhs) const noexcept { return coro_ == _rhs.coro_; }
+    bool operator!=(const generator_iterator& _rhs) const noexcept { return !(*this == _rhs); }
+
+private:
+    void resume()
+    {
+        coro_.resume();
+        if (coro_.done())
+        {
+            promise_type& promise = coro_.promise();
+            coro_ = nullptr;
+            promise.rethrow_if_exception();
+        }
+    }
+};
+
+} // end namespace detail
+
+// equal iterators hold the same coroutine handle, i.e. the same frame address
+template<typename T, typename Alloc>
+struct is_bitwise_comparable<detail::generator_iterator<T, Alloc>> : std::true_type {};
+
+/// Lazily produced sequence, written as a coroutine which co_yields its elements:
+///     tyti::generator<const row&> rows(cursor& c) { while (c.fetch_page()) for (const row& r : c.page()) co_yield r; }
+///     any_iterator<row, std::input_iterator_tag> it(gen.begin()), end(gen.end());
+/// Elements are yielded by reference, the iterator refers to the yielded object itself (temporaries
+/// live in the coroutine frame until the next increment), nothing is copied or buffered.
+/// generator<T> yields const T&, generator<T&> yields T&.
+/// The iterator is a single pass input iterator of one pointer, so any_iterator stores it inline
+/// and compares it without an indirect call; its copies share the position.
+/// The coroutine frame is allocated with Alloc (rebound): coroutines taking (std::allocator_arg, alloc, ...)
+/// use alloc, all others a default constructed Alloc, e.g. the same tyti::pool_allocator as the any_iterators.
+/// begin() may be called once. Exceptions of the coroutine are rethrown by begin() and operator++.
+/// co_await is not allowed inside of the coroutine.
+template<typename T, typename Alloc = std::allocator<unsigned char>>
+class generator
+{
+public:
+    using promise_type = detail::generator_promise<T, Alloc>;
+    using iterator = detail::generator_iterator<T, Alloc>;
+    using value_type = typename iterator::value_type;
+    using reference = typename iterator::reference;
+
+    generator(generator&& _rhs) noexcept : coro_(std::exchange(_rhs.coro_, nullptr)) {}
+
+    generator& operator=(generator _rhs) noexcept
+    {
+        std::swap(coro_, _rhs.coro_);
+        return *this;
+    }
+
+    ~generator()
+    {
+        if (coro_)
+            coro_.destroy();
+    }
+
+    /// runs the coroutine to the first co_yield
+    iterator begin()
+    {
+        iterator it(coro_);
+        if (coro_)
+            it.resume();
+        return it;
+    }
+
+    iterator end() const noexcept { return iterator(); }
+
+private:
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit generator(handle_type _coro) noexcept : coro_(_coro) {}
+
+    handle_type coro_;
+
+    friend promise_type;
+};
+
+} // end namespace tyti
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <typeinfo>
+
+namespace tyti {
+
+namespace detail {
+
+// name of the counted type, the mangled name when RTTI is available
+template<typename T>
+const char* stats_type_name()
+{
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+    return typeid(T).name();
+#else
+    return "(no rtti)";
+#endif
+}
+
+} // end namespace detail
+
+/// Option for any_iterator: counts heap allocations, copies, moves, type switches and
+/// the calls of the function table per wrapped iterator type, see iterator_stats.
+/// Defining TYTI_ANY_ITERATOR_STATS enables it for all any_iterators
+/// (has to be defined for all translation units of the program).
+/// Without the option (or macro), nothing is counted and no code is generated.
+struct count_stats {};
+
+/// Counters of one wrapped iterator type inside of one any_iterator type.
+/// Keyed on the function table (descriptor) of the wrapped type.
+/// All instances are registered in a global list, see first() and next().
+/// The counters are relaxed atomics, so any_iterators may be used from several threads.
+class iterator_stats
+{
+public:
+    using counter = std::atomic<std::size_t>;
+
+    /// (mangled) name of the wrapped iterator type, see detail::stats_type_name
+    const char* const name;
+    const std::size_t size;
+    /// true when the wrapped iterator does not fit into the inline buffer
+    const bool heap;
+    /// function table of the wrapped type
+    const void* const descriptor;
+
+    counter heap_allocations{ 0 };
+    counter heap_deallocations{ 0 };
+    /// assignments which replaced a heap iterator by another heap iterator
+    counter reallocations{ 0 };
+    /// assignments of an iterator of another wrapped type
+    counter type_switches{ 0 };
+    counter copies{ 0 };
+    counter moves{ 0 };
+
+    /// calls per function table entry
+    counter inc{ 0 };
+    counter dec{ 0 };
+    counter equal{ 0 };
+    counter deref{ 0 };
+    counter assign{ 0 };
+    counter advance{ 0 };
+    counter distance{ 0 };
+    counter subscript{ 0 };
+    counter less{ 0 };
+    counter next_block{ 0 };
+    counter skip{ 0 };
+    counter accumulate{ 0 };
+    counter visit{ 0 };
+
+    iterator_stats(const char* _name, std::size_t _size, bool _heap, const void* _descriptor)
+        : name(_name), size(_size), heap(_heap), descriptor(_descriptor), next_(nullptr)
+    {
+        // lock free push to the global list, instances are never removed
+        iterator_stats* head = head_().load(std::memory_order_relaxed);
+        do
+        {
+            next_ = head;
+        } while (!head_().compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    iterator_stats(const iterator_stats&) = delete;
+    iterator_stats& operator=(const iterator_stats&) = delete;
+
+    /// first entry of the list of all counted types
+    static iterator_stats* first()
+    {
+        return head_().load(std::memory_order_acquire);
+    }
+
+    iterator_stats* next() const
+    {
+        return next_;
+    }
+
+    void reset()
+    {
+        for (counter* c : counters())
+            c->store(0, std::memory_order_relaxed);
+    }
+
+    /// writes one line per counter which is not zero
+    friend std::ostream& operator<<(std::ostream& _os, const iterator_stats& _stats)
+    {
+        static const char* const names[] = {
+            "heap_allocations", "heap_deallocations", "reallocations", "type_switches", "copies", "moves",
+            "inc", "dec", "equal", "deref", "assign", "advance", "distance", "subscript", "less", "next_block", "skip", "accumulate", "visit" };
+        _os << _stats.name << " (" << _stats.size << " bytes, " << (_stats.heap ? "heap" : "inline") << ")\n";
+        const auto counters = _stats.counters();
+        for (std::size_t i = 0; i < counters.size(); ++i)
+        {
+            const std::size_t value = counters[i]->load(std::memory_order_relaxed);
+            if (value)
+                _os << "  " << names[i] << ": " << value << '\n';
+        }
+        return _os;
+    }
+
+private:
+    std::array<counter*, 19> counters()
+    {
+        return {{ &heap_allocations, &heap_deallocations, &reallocations, &type_switches, &copies, &moves,
+            &inc, &dec, &equal, &deref, &assign, &advance, &distance, &subscript, &less, &next_block, &skip, &accumulate, &visit }};
+    }
+
+    std::array<const counter*, 19> counters() const
+    {
+        return {{ &heap_allocations, &heap_deallocations, &reallocations, &type_switches, &copies, &moves,
+            &inc, &dec, &equal, &deref, &assign, &advance, &distance, &subscript, &less, &next_block, &skip, &accumulate, &visit }};
+    }
+
+    static std::atomic<iterator_stats*>& head_()
+    {
+        static std::atomic<iterator_stats*> head{ nullptr };
+        return head;
+    }
+
+    iterator_stats* next_;
+};
+
+/// writes the counters of all counted types
+inline void write_iterator_stats(std::ostream& _os)
+{
+    for (const iterator_stats* s = iterator_stats::first(); s; s = s->next())
+        _os << *s;
+}
+
+inline void reset_iterator_stats()
+{
+    for (iterator_stats* s = iterator_stats::first(); s; s = s->next())
+        s->reset();
+}
+
+} // end namespace tyti
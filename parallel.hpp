@@ -0,0 +1,193 @@
+#pragma once
+
+#include "any_range.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tyti {
+
+namespace detail {
+
+// runs _task(0) ... _task(_count - 1) on _threads threads (the calling thread included).
+// Every thread owns a deque of task indices, takes tasks from its back and steals
+// from the front of the other deques when it runs out of work.
+// The first exception of a task is rethrown after all threads are joined,
+// remaining tasks are skipped then. Threads which cannot be started are left out,
+// their tasks are stolen by the others.
+class work_stealing_executor
+{
+public:
+    template<typename Task>
+    static void run(std::size_t _count, std::size_t _threads, Task& _task)
+    {
+        if (_threads <= 1 || _count <= 1)
+        {
+            for (std::size_t i = 0; i < _count; ++i)
+                _task(i);
+            return;
+        }
+
+        work_stealing_executor executor(_count, _threads);
+        std::vector<std::thread> workers;
+        workers.reserve(_threads - 1);
+        try
+        {
+            for (std::size_t id = 1; id < _threads; ++id)
+                workers.emplace_back([&executor, &_task, id] { executor.work(id, _task); });
+        }
+        catch (...)
+        {
+            // could not start all threads (std::system_error, or std::bad_alloc for the state of the thread).
+            // Not an error of the tasks: the started threads and this one steal the rest.
+        }
+        executor.work(0, _task);
+        for (std::thread& t : workers)
+            t.join();
+        if (executor.error_)
+            std::rethrow_exception(executor.error_);
+    }
+
+private:
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    // consecutive tasks are given to the same thread, so neighboring parts are processed together
+    work_stealing_executor(std::size_t _count, std::size_t _threads)
+        : queues_(_threads)
+    {
+        for (std::size_t i = 0; i < _count; ++i)
+            queues_[i * _threads / _count].tasks.push_back(i);
+    }
+
+    bool pop(std::size_t _id, std::size_t& _task)
+    {
+        queue& own = queues_[_id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.tasks.empty())
+            return false;
+        _task = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t _id, std::size_t& _task)
+    {
+        for (std::size_t i = 1; i < queues_.size(); ++i)
+        {
+            queue& victim = queues_[(_id + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                _task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fail(std::exception_ptr _error)
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!error_)
+            error_ = _error;
+    }
+
+    bool failed()
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        return static_cast<bool>(error_);
+    }
+
+    // tasks do not spawn tasks, so the work is done when all queues are empty
+    template<typename Task>
+    void work(std::size_t _id, Task& _task)
+    {
+        std::size_t task;
+        while (pop(_id, task) || steal(_id, task))
+        {
+            if (failed())
+                continue; // drain the queues
+            try
+            {
+                _task(task);
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        }
+    }
+
+    std::vector<queue> queues_;
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+// number of parts per thread, more parts balance the load when elements have different costs
+constexpr std::size_t parts_per_thread = 4;
+
+inline std::size_t default_threads()
+{
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+} // end namespace detail
+
+/// Applies _f to every element of _range on _threads threads.
+/// The range is split (see any_range::split) and the parts are processed by a work stealing scheduler,
+/// every part blockwise (see any_range::for_each). _f is called concurrently and has to be thread safe.
+/// The wrapped iterators have to allow concurrent traversal of disjoint parts (like all standard containers).
+/// _threads = 0 is treated as 1, i.e. the calling thread processes all parts.
+template<typename T, typename... Options, typename F>
+void parallel_for_each(const any_range<T, Options...>& _range, F _f, std::size_t _threads = detail::default_threads())
+{
+    _threads = std::max<std::size_t>(_threads, 1);
+    const std::vector<any_range<T, Options...>> parts = _range.split(_threads * detail::parts_per_thread);
+    auto task = [&](std::size_t _i) { parts[_i].for_each(_f); };
+    detail::work_stealing_executor::run(parts.size(), _threads, task);
+}
+
+/// Reduces _range in parallel: every part is accumulated with _op(Acc, element) starting from _identity,
+/// the results of the parts are combined in order with _combine(Acc, Acc).
+/// _identity has to be the neutral element of _combine and _combine has to be associative.
+/// _threads = 0 is treated as 1.
+template<typename T, typename... Options, typename Acc, typename Op, typename Combine,
+    class = typename std::enable_if<!std::is_integral<Combine>::value>::type>
+Acc parallel_reduce(const any_range<T, Options...>& _range, Acc _identity, Op _op, Combine _combine,
+    std::size_t _threads = detail::default_threads())
+{
+    _threads = std::max<std::size_t>(_threads, 1);
+    const std::vector<any_range<T, Options...>> parts = _range.split(_threads * detail::parts_per_thread);
+    // wrapped, so the results are distinct objects (std::vector<bool>)
+    struct result_t { Acc value; };
+    std::vector<result_t> results(parts.size(), result_t{ _identity });
+    auto task = [&](std::size_t _i) { results[_i].value = parts[_i].accumulate(std::move(results[_i].value), _op); };
+    detail::work_stealing_executor::run(parts.size(), _threads, task);
+
+    for (result_t& result : results)
+        _identity = _combine(std::move(_identity), std::move(result.value));
+    return _identity;
+}
+
+/// parallel_reduce with the same operation for the elements and the partial results, e.g. std::plus<>
+template<typename T, typename... Options, typename Acc, typename Op>
+Acc parallel_reduce(const any_range<T, Options...>& _range, Acc _identity, Op _op,
+    std::size_t _threads = detail::default_threads())
+{
+    return parallel_reduce(_range, std::move(_identity), _op, _op, _threads);
+}
+
+} // end namespace tyti
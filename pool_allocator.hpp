@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef> //size_t, max_align_t
+#include <new> //operator new/delete
+
+namespace tyti {
+
+namespace detail {
+
+// thread local cache of fixed size blocks.
+// Blocks are allocated one by one from the global heap and kept in free lists
+// after deallocation, so after a warm up no global allocation is done anymore.
+// Blocks are not bound to a thread, a block allocated by one thread
+// can be deallocated by another one and is cached there.
+// The pool is destroyed at the exit of its thread, destructors which run later
+// (other thread_local or static objects) get no pool and use the global heap.
+class block_pool
+{
+public:
+    static constexpr std::size_t granularity = alignof(std::max_align_t);
+    static constexpr std::size_t size_classes = 16; // blocks up to 16 * granularity bytes
+    static constexpr std::size_t max_cached = 256; // per size class
+
+    // the pool of the calling thread, nullptr after it was destroyed
+    static block_pool* instance()
+    {
+        static thread_local block_pool pool;
+        return destroyed() ? nullptr : &pool;
+    }
+
+    void* allocate(std::size_t _bytes)
+    {
+        const std::size_t cls = size_class(_bytes);
+        if (cls >= size_classes)
+            return ::operator new(_bytes);
+        if (FreeBlock* block = free_[cls])
+        {
+            free_[cls] = block->next;
+            --cached_[cls];
+            return block;
+        }
+        return ::operator new((cls + 1) * granularity);
+    }
+
+    void deallocate(void* _ptr, std::size_t _bytes) noexcept
+    {
+        const std::size_t cls = size_class(_bytes);
+        if (cls >= size_classes || cached_[cls] >= max_cached)
+        {
+            ::operator delete(_ptr);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(_ptr);
+        block->next = free_[cls];
+        free_[cls] = block;
+        ++cached_[cls];
+    }
+
+    ~block_pool()
+    {
+        for (std::size_t cls = 0; cls < size_classes; ++cls)
+        {
+            while (FreeBlock* block = free_[cls])
+            {
+                free_[cls] = block->next;
+                ::operator delete(block);
+            }
+        }
+        destroyed() = true;
+    }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    block_pool() : free_(), cached_() {}
+    block_pool(const block_pool&) = delete;
+    block_pool& operator=(const block_pool&) = delete;
+
+    // trivially destructible, so it is still valid after the pool
+    static bool& destroyed()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    static std::size_t size_class(std::size_t _bytes)
+    {
+        return (_bytes == 0) ? 0 : (_bytes - 1) / granularity;
+    }
+
+    FreeBlock* free_[size_classes];
+    std::size_t cached_[size_classes];
+};
+
+} // end namespace detail
+
+/// Stateless allocator using a thread local pool of fixed size blocks.
+/// Can be given as allocator option to any_iterator, e.g.
+/// any_iterator<int, tyti::pool_allocator<unsigned char>>,
+/// so heap stored iterators do not hit the global heap on the hot path.
+/// Supports types up to alignof(std::max_align_t).
+/// Blocks may be deallocated after the pool of the thread was destroyed, e.g. by static objects.
+template<typename T>
+class pool_allocator
+{
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+    pool_allocator() noexcept {}
+    template<typename U>
+    pool_allocator(const pool_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t _n)
+    {
+        detail::block_pool* pool = detail::block_pool::instance();
+        return static_cast<T*>(pool ? pool->allocate(_n * sizeof(T)) : ::operator new(_n * sizeof(T)));
+    }
+
+    void deallocate(T* _ptr, std::size_t _n) noexcept
+    {
+        if (detail::block_pool* pool = detail::block_pool::instance())
+            pool->deallocate(_ptr, _n * sizeof(T));
+        else
+            ::operator delete(_ptr);
+    }
+
+    template<typename U>
+    bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const pool_allocator<U>&) const noexcept { return false; }
+};
+
+} // end namespace tyti
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <iterator>
+
+#include <cstddef>
+#include <memory> //addressof
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace tyti {
+
+namespace detail {
+
+// hint to load the cache line of _ptr, no-op where no intrinsic is available
+inline void prefetch(const void* _ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(_ptr, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(_ptr), _MM_HINT_T0);
+#else
+    (void)_ptr;
+#endif
+}
+
+} // end namespace detail
+
+/// Forward iterator adaptor which prefetches the elements Distance steps ahead.
+/// Keeps a second iterator Distance elements in front of the current position (bounded by the end)
+/// and issues a prefetch for the element it points to on every increment.
+/// Usually wrapped into an any_iterator:
+///     any_iterator<int, std::forward_iterator_tag> it(make_prefetch_iterator<16>(v.begin(), v.end()));
+/// It pays off when the increment is cheap but the element is a cache miss, e.g. iterators over
+/// pointers or indices into a big table. For std::list and std::map the lookahead iterator has to
+/// chase the same pointers, the misses stay serialized and the additional increments make the loop slower.
+/// Measure with benchmark_prefetch (the benchmark_run target) before using it.
+template<typename Iter, std::size_t Distance = 8>
+class prefetch_iterator
+{
+    static_assert(Distance > 0, "the prefetch distance has to be at least one element");
+    static_assert(std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>::value,
+        "prefetch_iterator requires a forward iterator");
+
+    Iter it_;
+    Iter ahead_;
+    Iter end_;
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::iterator_traits<Iter>::value_type;
+    using difference_type = typename std::iterator_traits<Iter>::difference_type;
+    using pointer = typename std::iterator_traits<Iter>::pointer;
+    using reference = typename std::iterator_traits<Iter>::reference;
+
+    prefetch_iterator() : it_(), ahead_(), end_() {}
+
+    /// iterates [_it, _end), the first Distance elements are prefetched right away
+    prefetch_iterator(Iter _it, Iter _end)
+        : it_(std::move(_it)), ahead_(it_), end_(std::move(_end))
+    {
+        for (std::size_t i = 0; i < Distance && ahead_ != end_; ++i)
+        {
+            ++ahead_;
+            prefetch_ahead();
+        }
+    }
+
+    const Iter& base() const { return it_; }
+
+    reference operator*() const { return *it_; }
+    pointer operator->() const { return std::addressof(*it_); }
+
+    prefetch_iterator& operator++()
+    {
+        ++it_;
+        if (ahead_ != end_)
+        {
+            ++ahead_;
+            prefetch_ahead();
+        }
+        return *this;
+    }
+
+    prefetch_iterator operator++(int)
+    {
+        prefetch_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    // positions are compared, the window does not matter
+    bool operator==(const prefetch_iterator& _rhs) const { return it_ == _rhs.it_; }
+    bool operator!=(const prefetch_iterator& _rhs) const { return it_ != _rhs.it_; }
+
+private:
+    void prefetch_ahead() const
+    {
+        if (ahead_ != end_)
+            detail::prefetch(std::addressof(*ahead_));
+    }
+};
+
+template<std::size_t Distance, typename Iter>
+prefetch_iterator<Iter, Distance> make_prefetch_iterator(Iter _it, Iter _end)
+{
+    return prefetch_iterator<Iter, Distance>(std::move(_it), std::move(_end));
+}
+
+} // end namespace tyti
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <iterator>
+
+#include <algorithm> //min, max
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring> //memcpy
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(TYTI_HAS_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define TYTI_HAS_MMAP 1
+#endif
+
+#if TYTI_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Iterator sources over binary record files, to be wrapped into any_iterators:
+// - fixed size records: the file is an array of trivially copyable Records
+// - length prefixed records: every record is a std::uint32_t length (native byte order)
+//   followed by that many bytes
+// mapped_file maps the whole file read-only (POSIX), its iterators point into the mapping.
+// record_reader and prefixed_record_reader are the buffered fallback (std::fread),
+// e.g. for platforms without mmap, pipes or files bigger than the address space.
+
+namespace tyti {
+
+/// Bytes of one length prefixed record, points into the mapping or the buffer of the reader
+struct record_view
+{
+    const char* data;
+    std::size_t size;
+
+    std::string str() const { return std::string(data, size); }
+};
+
+using record_length = std::uint32_t;
+
+/// Iterator over length prefixed records in memory [_first, _last), e.g. in a mapped_file.
+/// Forward only, the records can not be found backwards.
+/// operator* returns a record_view into the memory (use the tyti::by_value option of any_iterator).
+/// Throws std::runtime_error for a record which exceeds the memory.
+class prefixed_record_iterator
+{
+    const char* pos_;
+    const char* last_;
+
+    record_length length() const
+    {
+        record_length n;
+        std::memcpy(&n, pos_, sizeof(n));
+        return n;
+    }
+
+    void check() const
+    {
+        if (pos_ != last_ && (static_cast<std::size_t>(last_ - pos_) < sizeof(record_length)
+            || static_cast<std::size_t>(last_ - pos_) - sizeof(record_length) < length()))
+            throw std::runtime_error("truncated record");
+    }
+
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = record_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const record_view*;
+    using reference = record_view;
+
+    prefixed_record_iterator() : pos_(nullptr), last_(nullptr) {}
+
+    prefixed_record_iterator(const char* _pos, const char* _last)
+        : pos_(_pos), last_(_last)
+    {
+        check();
+    }
+
+    record_view operator*() const
+    {
+        return record_view{ pos_ + sizeof(record_length), length() };
+    }
+
+    prefixed_record_iterator& operator++()
+    {
+        pos_ += sizeof(record_length) + length();
+        check();
+        return *this;
+    }
+
+    prefixed_record_iterator operator++(int)
+    {
+        prefixed_record_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    bool operator==(const prefixed_record_iterator& _rhs) const { return pos_ == _rhs.pos_; }
+    bool operator!=(const prefixed_record_iterator& _rhs) const { return pos_ != _rhs.pos_; }
+};
+
+/// begin and end of the records of a file, can be passed to any_range
+template<typename Iter>
+struct record_range
+{
+    Iter first;
+    Iter last;
+
+    Iter begin() const { return first; }
+    Iter end() const { return last; }
+};
+
+#if TYTI_HAS_MMAP
+
+/// Read-only memory mapping of a whole file, move only.
+/// The access hint is given to the kernel with madvise (sequential: aggressive read ahead,
+/// pages behind are dropped early).
+class mapped_file
+{
+public:
+    enum class access { normal, sequential, random };
+
+    explicit mapped_file(const std::string& _path, access _access = access::sequential)
+        : data_(nullptr), size_(0)
+    {
+        const int fd = ::open(_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + _path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "fstat " + _path);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) // empty files can not be mapped
+        {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                const int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "mmap " + _path);
+            }
+            data_ = static_cast<const char*>(data);
+            advise(_access);
+        }
+        ::close(fd); // the mapping keeps the file open
+    }
+
+    mapped_file(mapped_file&& _rhs) noexcept
+        : data_(_rhs.data_), size_(_rhs.size_)
+    {
+        _rhs.data_ = nullptr;
+        _rhs.size_ = 0;
+    }
+
+    mapped_file& operator=(mapped_file&& _rhs) noexcept
+    {
+        if (this != &_rhs)
+        {
+            unmap();
+            data_ = _rhs.data_;
+            size_ = _rhs.size_;
+            _rhs.data_ = nullptr;
+            _rhs.size_ = 0;
+        }
+        return *this;
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file()
+    {
+        unmap();
+    }
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    /// changes the access hint, e.g. to random before binary searches
+    void advise(access _access) const
+    {
+        if (!data_)
+            return;
+        const int advice = _access == access::sequential ? MADV_SEQUENTIAL
+            : _access == access::random ? MADV_RANDOM : MADV_NORMAL;
+        ::madvise(const_cast<char*>(data_), size_, advice); // only a hint, errors are ignored
+    }
+
+    /// Fixed size records starting at _offset, as pointers into the mapping (random access, zero copy).
+    /// Throws std::runtime_error if the records do not fill the file or are misaligned.
+    template<typename Record>
+    record_range<const Record*> records(std::size_t _offset = 0) const
+    {
+        static_assert(std::is_trivially_copyable<Record>::value, "records have to be trivially copyable");
+        if (_offset > size_ || (size_ - _offset) % sizeof(Record) != 0)
+            throw std::runtime_error("file size is not a multiple of the record size");
+        if (_offset % alignof(Record) != 0)
+            throw std::runtime_error("misaligned records");
+        // the mapping is page aligned
+        const Record* first = data_ ? reinterpret_cast<const Record*>(data_ + _offset) : nullptr;
+        return record_range<const Record*>{ first, first + (size_ - _offset) / sizeof(Record) };
+    }
+
+    /// Length prefixed records starting at _offset
+    record_range<prefixed_record_iterator> prefixed_records(std::size_t _offset = 0) const
+    {
+        if (_offset > size_)
+            throw std::runtime_error("offset behind the end of the file");
+        const char* last = data_ + size_;
+        return record_range<prefixed_record_iterator>{
+            prefixed_record_iterator(data_ + _offset, last), prefixed_record_iterator(last, last) };
+    }
+
+private:
+    void unmap()
+    {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char* data_;
+    std::size_t size_;
+};
+
+#endif // TYTI_HAS_MMAP
+
+namespace detail {
+
+struct file_closer
+{
+    void operator()(std::FILE* _file) const { std::fclose(_file); }
+};
+
+inline std::unique_ptr<std::FILE, file_closer> open_file(const std::string& _path)
+{
+    std::unique_ptr<std::FILE, file_closer> file(std::fopen(_path.c_str(), "rb"));
+    if (!file)
+        throw std::system_error(errno, std::generic_category(), "fopen " + _path);
+    return file;
+}
+
+// fread does not set errno (ISO C), errors of the stream are reported as EIO
+inline void check_read(std::FILE* _file)
+{
+    if (std::ferror(_file))
+        throw std::system_error(std::make_error_code(std::errc::io_error), "fread");
+}
+
+} // end namespace detail
+
+/// Buffered reader of fixed size records, reads _buffer_records records per std::fread.
+/// Its iterators are single pass input iterators (any_iterator<Record, std::input_iterator_tag>),
+/// operator* refers into the buffer and is valid until the next increment.
+/// Throws std::runtime_error if the records do not fill the file (when the end is read)
+/// and std::system_error (std::errc::io_error) if reading fails.
+template<typename Record>
+class record_reader
+{
+    static_assert(std::is_trivially_copyable<Record>::value, "records have to be trivially copyable");
+
+    std::unique_ptr<std::FILE, detail::file_closer> file_;
+    std::vector<Record> buffer_;
+    std::size_t pos_;
+    std::size_t count_;
+
+    // returns false at the end of the file, throws for a truncated last record.
+    // Reads bytes, fread of whole records would drop the rest of a truncated one.
+    bool fill()
+    {
+        pos_ = 0;
+        const std::size_t bytes = std::fread(buffer_.data(), 1, buffer_.size() * sizeof(Record), file_.get());
+        detail::check_read(file_.get());
+        if (bytes % sizeof(Record) != 0)
+            throw std::runtime_error("file size is not a multiple of the record size");
+        count_ = bytes / sizeof(Record);
+        return count_ > 0;
+    }
+
+public:
+    class iterator
+    {
+        record_reader* reader_; // nullptr for the end
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Record*;
+        using reference = const Record&;
+
+        iterator() : reader_(nullptr) {}
+        explicit iterator(record_reader* _reader) : reader_(_reader) {}
+
+        reference operator*() const { return reader_->buffer_[reader_->pos_]; }
+        pointer operator->() const { return &**this; }
+
+        iterator& operator++()
+        {
+            if (!reader_->next())
+                reader_ = nullptr;
+            return *this;
+        }
+
+        // keeps a copy of the record for *it++
+        class postinc_proxy
+        {
+            Record value_;
+        public:
+            explicit postinc_proxy(const Record& _value) : value_(_value) {}
+            const Record& operator*() const { return value_; }
+        };
+
+        postinc_proxy operator++(int)
+        {
+            postinc_proxy tmp(**this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator& _rhs) const { return reader_ == _rhs.reader_; }
+        bool operator!=(const iterator& _rhs) const { return reader_ != _rhs.reader_; }
+    };
+
+    explicit record_reader(const std::string& _path, std::size_t _buffer_records = 64 * 1024 / sizeof(Record) + 1)
+        : file_(detail::open_file(_path)), buffer_(_buffer_records), pos_(0), count_(0)
+    {
+    }
+
+    /// the first unread record, can be called once
+    iterator begin() { return fill() ? iterator(this) : iterator(); }
+    iterator end() { return iterator(); }
+
+private:
+    bool next()
+    {
+        if (++pos_ < count_)
+            return true;
+        if (count_ < buffer_.size()) // the last fread hit the end
+            return false;
+        return fill();
+    }
+};
+
+/// Buffered reader of length prefixed records, see record_reader.
+/// operator* returns a record_view into the buffer, valid until the next increment.
+/// Throws std::runtime_error for a truncated record and std::system_error (std::errc::io_error) if reading fails.
+class prefixed_record_reader
+{
+    std::unique_ptr<std::FILE, detail::file_closer> file_;
+    std::vector<char> buffer_;
+    std::size_t size_;
+
+    // returns false at the end of the file, throws for truncated records
+    bool read_record()
+    {
+        record_length n;
+        const std::size_t got = std::fread(&n, 1, sizeof(n), file_.get());
+        detail::check_read(file_.get());
+        if (got == 0)
+            return false;
+        if (got != sizeof(n))
+            throw std::runtime_error("truncated record");
+        // the length is not trusted (pipes have no size to check it against):
+        // the buffer grows with the bytes read, at most doubling per read
+        const std::size_t min_growth = 64 * 1024;
+        std::size_t size = 0;
+        while (size < n)
+        {
+            if (buffer_.size() == size)
+                buffer_.resize(size + std::min<std::size_t>(n - size, std::max(size, min_growth)));
+            const std::size_t wanted = std::min<std::size_t>(buffer_.size(), n) - size;
+            const std::size_t read = std::fread(buffer_.data() + size, 1, wanted, file_.get());
+            detail::check_read(file_.get());
+            if (read != wanted)
+                throw std::runtime_error("truncated record");
+            size += read;
+        }
+        size_ = n;
+        return true;
+    }
+
+public:
+    class iterator
+    {
+        prefixed_record_reader* reader_; // nullptr for the end
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = record_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const record_view*;
+        using reference = record_view;
+
+        iterator() : reader_(nullptr) {}
+        explicit iterator(prefixed_record_reader* _reader) : reader_(_reader) {}
+
+        record_view operator*() const { return record_view{ reader_->buffer_.data(), reader_->size_ }; }
+
+        iterator& operator++()
+        {
+            if (!reader_->read_record())
+                reader_ = nullptr;
+            return *this;
+        }
+
+        // keeps a copy of the record for *it++
+        class postinc_proxy
+        {
+            std::string value_;
+        public:
+            explicit postinc_proxy(const record_view& _value) : value_(_value.data, _value.size) {}
+            record_view operator*() const { return record_view{ value_.data(), value_.size() }; }
+        };
+
+        postinc_proxy operator++(int)
+        {
+            postinc_proxy tmp(**this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator& _rhs) const { return reader_ == _rhs.reader_; }
+        bool operator!=(const iterator& _rhs) const { return reader_ != _rhs.reader_; }
+    };
+
+    /// std::fread is buffered by the FILE, setvbuf sets its size to _buffer_size
+    explicit prefixed_record_reader(const std::string& _path, std::size_t _buffer_size = 64 * 1024)
+        : file_(detail::open_file(_path)), size_(0)
+    {
+        std::setvbuf(file_.get(), nullptr, _IOFBF, _buffer_size);
+    }
+
+    /// the first unread record, can be called once
+    iterator begin() { return read_record() ? iterator(this) : iterator(); }
+    iterator end() { return iterator(); }
+};
+
+} // end namespace tyti
@@ -1,9 +1,25 @@
 #include <catch.hpp>
 #include <any_iterator.hpp>
+#include <any_range.hpp>
+#include <pool_allocator.hpp>
+#include <prefetch_iterator.hpp>
+#include "test_helpers.hpp"
 
 // containers
 #include <vector>
 #include <list>
+#include <forward_list>
+#include <map>
+
+#include <algorithm>
+#include <memory>
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <iterator>
 
 TEST_CASE("basic inc-/decrement", "[basic]")
 {
@@ -99,3 +115,826 @@ TEST_CASE("basic inc-/decrement", "[basic]")
     }
 }
 
+
+TEST_CASE("inline buffer", "[basic]")
+{
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> vl = { 6, 11, 21, 33 };
+
+    SECTION("heap iterator")
+    {
+        tyti::any_iterator<int> it(make_oversized(vc.begin()));
+        auto itc = vc.begin();
+        for (; it != make_oversized(vc.end()); ++it, ++itc)
+            REQUIRE(*it == *itc);
+        tyti::any_iterator<int> cpy(it);
+        REQUIRE(cpy == it);
+        --cpy;
+        REQUIRE(*cpy == vc.back());
+    }
+
+    SECTION("switch between heap and inline")
+    {
+        tyti::any_iterator<int> it(vl.begin());
+        it = make_oversized(vc.begin());
+        REQUIRE(*it == vc.front());
+        it = vl.begin();
+        REQUIRE(*it == vl.front());
+        it = make_oversized(vc.begin());
+        tyti::any_iterator<int> moved(std::move(it));
+        REQUIRE(*moved == vc.front());
+        it = moved;
+        REQUIRE(it == moved);
+    }
+
+    SECTION("custom buffer size")
+    {
+        using big_any = tyti::any_iterator<int, tyti::inline_buffer<128>>;
+        big_any it(make_oversized(vc.begin()));
+        big_any post = it++;
+        REQUIRE(*post == vc[0]);
+        REQUIRE(*it == vc[1]);
+        static_assert(sizeof(big_any) >= 128 + sizeof(void*), "buffer is inline");
+    }
+}
+
+TEST_CASE("iterator categories", "[basic]")
+{
+    std::vector<int> vc = { 5,10,20,40,80 };
+    using ra_iterator = tyti::any_iterator<int, std::random_access_iterator_tag>;
+    static_assert(std::is_same<std::iterator_traits<ra_iterator>::iterator_category, std::random_access_iterator_tag>::value, "category");
+
+    SECTION("random access jumps")
+    {
+        ra_iterator it(vc.begin());
+        const ra_iterator it_end(vc.end());
+        REQUIRE(it_end - it == 5);
+        REQUIRE(std::distance(it, it_end) == 5);
+        REQUIRE(it[2] == 20);
+        it += 3;
+        REQUIRE(*it == 40);
+        it -= 2;
+        REQUIRE(*it == 10);
+        REQUIRE(*(it + 1) == 20);
+        REQUIRE(*(1 + it) == 20);
+        REQUIRE(*(it - 1) == 5);
+        REQUIRE(it < it_end);
+        REQUIRE(it_end > it);
+        REQUIRE(it <= it);
+        REQUIRE(it >= it);
+        std::advance(it, 3);
+        REQUIRE(*it == 80);
+    }
+
+    SECTION("binary search")
+    {
+        ra_iterator first(vc.begin());
+        const ra_iterator last(vc.end());
+        REQUIRE(*std::lower_bound(first, last, 15) == 20);
+        REQUIRE(std::binary_search(first, last, 40));
+        REQUIRE(!std::binary_search(first, last, 41));
+    }
+
+    SECTION("forward iterator")
+    {
+        std::forward_list<int> fl = { 1,2,3 };
+        tyti::any_iterator<int, std::forward_iterator_tag> it(fl.begin());
+        int sum = 0;
+        for (; it != fl.end(); ++it)
+            sum += *it;
+        REQUIRE(sum == 6);
+    }
+}
+
+TEST_CASE("blockwise traversal", "[basic]")
+{
+    std::list<int> vl(1000);
+    int n = 0;
+    for (auto& v : vl)
+        v = n++;
+    const int expected = 999 * 1000 / 2;
+
+    SECTION("for_each")
+    {
+        int sum = 0;
+        tyti::for_each(tyti::any_iterator<int>(vl.begin()), tyti::any_iterator<int>(vl.end()), [&sum](int v) { sum += v; });
+        REQUIRE(sum == expected);
+    }
+
+    SECTION("next_block")
+    {
+        tyti::any_iterator<int> it(vl.begin());
+        const tyti::any_iterator<int> it_end(vl.end());
+        const int* block[100];
+        REQUIRE(it.next_block(it_end, block, 100) == 100);
+        REQUIRE(*block[99] == 99);
+        REQUIRE(*it == 100);
+        size_t count = 100;
+        while (size_t k = it.next_block(it_end, block, 100))
+            count += k;
+        REQUIRE(count == vl.size());
+        REQUIRE(it == it_end);
+        REQUIRE(it.next_block(it_end, block, 100) == 0);
+    }
+
+    SECTION("empty range")
+    {
+        int calls = 0;
+        tyti::for_each(tyti::any_iterator<int>(vl.end()), tyti::any_iterator<int>(vl.end()), [&calls](int) { ++calls; });
+        REQUIRE(calls == 0);
+    }
+}
+
+TEST_CASE("mutable and output iterators", "[basic]")
+{
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> vl = { 6, 11, 21, 33 };
+
+    SECTION("write through mutable iterator")
+    {
+        using mutable_iterator = tyti::any_iterator<int&>;
+        static_assert(std::is_same<mutable_iterator::reference, int&>::value, "mutable reference");
+        static_assert(std::is_same<mutable_iterator::value_type, int>::value, "value_type");
+        static_assert(std::is_same<tyti::any_iterator<int>::reference, const int&>::value, "const reference");
+
+        mutable_iterator it(vl.begin());
+        *it = 1;
+        REQUIRE(vl.front() == 1);
+        std::fill(mutable_iterator(vc.begin()), mutable_iterator(vc.end()), 7);
+        REQUIRE(vc == std::vector<int>({ 7,7,7 }));
+        std::transform(mutable_iterator(vl.begin()), mutable_iterator(vl.end()), mutable_iterator(vl.begin()), [](int v) { return v * 2; });
+        REQUIRE(vl == std::list<int>({ 2, 22, 42, 66 }));
+    }
+
+    SECTION("output iterator")
+    {
+        using output_iterator = tyti::any_iterator<int, std::output_iterator_tag>;
+        std::vector<int> out;
+        output_iterator it(std::back_inserter(out));
+        *it = 1;
+        ++it;
+        *it++ = 2;
+        std::copy(vl.begin(), vl.end(), it);
+        REQUIRE(out == std::vector<int>({ 1, 2, 6, 11, 21, 33 }));
+
+        // mutable forward iterators are output iterators, too
+        it = vc.begin();
+        std::copy(vl.begin(), std::next(vl.begin(), 3), it);
+        REQUIRE(vc == std::vector<int>({ 6, 11, 21 }));
+    }
+}
+
+// generates the values [n, ...) on the fly, operator* returns by value
+struct counting_iterator
+{
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = int;
+
+    int n;
+
+    int operator*() const { return n; }
+    int operator[](std::ptrdiff_t _i) const { return n + static_cast<int>(_i); }
+    counting_iterator& operator++() { ++n; return *this; }
+    counting_iterator& operator--() { --n; return *this; }
+    counting_iterator& operator+=(std::ptrdiff_t _i) { n += static_cast<int>(_i); return *this; }
+    std::ptrdiff_t operator-(const counting_iterator& _rhs) const { return n - _rhs.n; }
+    bool operator==(const counting_iterator& _rhs) const { return n == _rhs.n; }
+    bool operator!=(const counting_iterator& _rhs) const { return n != _rhs.n; }
+    bool operator<(const counting_iterator& _rhs) const { return n < _rhs.n; }
+};
+
+TEST_CASE("by value iterators", "[basic]")
+{
+    SECTION("generated sequence")
+    {
+        using value_iterator = tyti::any_iterator<int, std::random_access_iterator_tag, tyti::by_value>;
+        static_assert(std::is_same<value_iterator::reference, int>::value, "by value");
+        value_iterator it(counting_iterator{ 0 });
+        const value_iterator it_end(counting_iterator{ 100 });
+        REQUIRE(*it == 0);
+        REQUIRE(it[10] == 10);
+        REQUIRE(std::accumulate(it, it_end, 0) == 99 * 100 / 2);
+        int sum = 0;
+        tyti::for_each(it, it_end, [&sum](int v) { sum += v; });
+        REQUIRE(sum == 99 * 100 / 2);
+        REQUIRE(*std::lower_bound(it, it_end, 42) == 42);
+    }
+
+    SECTION("vector<bool>")
+    {
+        std::vector<bool> vb = { true, false, true };
+        tyti::any_iterator<bool, tyti::by_value> it(vb.begin());
+        REQUIRE(*it);
+        ++it;
+        REQUIRE(!*it);
+        REQUIRE(std::count(tyti::any_iterator<bool, tyti::by_value>(vb.begin()), tyti::any_iterator<bool, tyti::by_value>(vb.end()), true) == 2);
+    }
+
+    SECTION("operator->")
+    {
+        std::vector<std::pair<int, int>> vp = { {1, 2} };
+        tyti::any_iterator<std::pair<int, int>, tyti::by_value> it(vp.begin());
+        REQUIRE(it->second == 2);
+    }
+}
+
+TEST_CASE("allocator option", "[basic]")
+{
+    std::vector<int> vc = { 5,10,20 };
+    using counted_iterator = tyti::any_iterator<int, counting_alloc<unsigned char>>;
+    // allocations of all rebinds are counted
+    const allocation_probe probe;
+
+    SECTION("heap iterators use the allocator")
+    {
+        {
+            counted_iterator it(make_oversized(vc.begin()));
+            REQUIRE(probe.allocations() == 1);
+            counted_iterator cpy(it);
+            REQUIRE(probe.allocations() == 2);
+            counted_iterator moved(std::move(cpy));
+            REQUIRE(probe.allocations() == 2);
+            ++moved;
+            REQUIRE(*moved == 10);
+        }
+        REQUIRE(probe.deallocations() == 2);
+    }
+
+    SECTION("inline iterators do not allocate")
+    {
+        counted_iterator it(vc.begin());
+        counted_iterator cpy(it);
+        cpy++;
+        REQUIRE(probe.allocations() == 0);
+    }
+
+    SECTION("pool allocator")
+    {
+        using pool_iterator = tyti::any_iterator<int, tyti::pool_allocator<unsigned char>>;
+        pool_iterator it(make_oversized(vc.begin()));
+        for (int i = 0; i < 3; ++i)
+        {
+            pool_iterator cpy(it);
+            REQUIRE(*cpy++ == 5);
+            REQUIRE(*cpy == 10);
+        }
+        it = vc.begin();
+        REQUIRE(*it == 5);
+
+        // freed by a destructor at thread exit, after the pool of the thread is gone
+        bool freed = false;
+        std::thread([&vc, &freed]
+        {
+            struct exit_holder
+            {
+                std::unique_ptr<pool_iterator> it;
+                bool* freed;
+                ~exit_holder()
+                {
+                    it.reset();
+                    *freed = true;
+                }
+            };
+            // constructed before the pool, so it is destroyed after it
+            static thread_local exit_holder holder;
+            holder.freed = &freed;
+            holder.it.reset(new pool_iterator(make_oversized(vc.begin())));
+        }).join();
+        REQUIRE(freed);
+    }
+
+#if defined(__cpp_lib_memory_resource)
+    SECTION("polymorphic allocator")
+    {
+        unsigned char buffer[1024];
+        std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        using pmr_iterator = tyti::any_iterator<int, std::pmr::polymorphic_allocator<unsigned char>>;
+        pmr_iterator it(make_oversized(vc.begin()), &resource);
+        pmr_iterator cpy(it);
+        REQUIRE(cpy.get_allocator().resource() == std::pmr::get_default_resource());
+        pmr_iterator moved(std::move(it));
+        REQUIRE(moved.get_allocator().resource() == &resource);
+        cpy = std::move(moved); // different resources, copied
+        REQUIRE(*cpy == 5);
+    }
+#endif
+}
+
+TEST_CASE("post-increment", "[basic]")
+{
+    std::vector<int> vc = { 5,10,20 };
+
+    SECTION("trivially copyable iterators")
+    {
+        static_assert(std::is_trivially_copyable<std::vector<int>::iterator>::value, "");
+        tyti::any_iterator<int> it(vc.begin());
+        tyti::any_iterator<int> old = it++;
+        REQUIRE(*old == 5);
+        REQUIRE(*it == 10);
+        tyti::any_iterator<int> moved(std::move(old));
+        REQUIRE(*moved == 5);
+        REQUIRE(*it-- == 10);
+        REQUIRE(it == moved);
+    }
+
+    SECTION("input iterators return the value")
+    {
+        std::istringstream in("1 2 3");
+        using input_iterator = tyti::any_iterator<int, std::input_iterator_tag, tyti::by_value>;
+        input_iterator it{ std::istream_iterator<int>(in) };
+        const input_iterator last{ std::istream_iterator<int>() };
+        std::vector<int> values;
+        while (it != last)
+            values.push_back(*it++);
+        REQUIRE(values == std::vector<int>({ 1,2,3 }));
+    }
+
+    SECTION("heap iterators allocate only for the copy")
+    {
+        using counted_iterator = tyti::any_iterator<int, counting_alloc<unsigned char>>;
+        counted_iterator it(make_oversized(vc.begin()));
+        const allocation_probe probe;
+        REQUIRE(*it++ == 5);
+        REQUIRE(probe.allocations() == 1); // one copy per post-increment
+        ++it;
+        REQUIRE(probe.allocations() == 1);
+    }
+}
+
+// same behavior for every dispatch policy, see tyti::table_dispatch
+template<typename Iter>
+void check_dispatch()
+{
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> l = { 1,2 };
+
+    Iter it(vc.begin());
+    const Iter last(vc.end());
+    REQUIRE(std::accumulate(it, last, 0) == 35);
+
+    it = l.begin();
+    REQUIRE(*it++ == 1);
+    REQUIRE(*it == 2);
+    Iter cpy(it);
+    REQUIRE(cpy == it);
+    REQUIRE(cpy != last);
+    REQUIRE(*--cpy == 1);
+
+    Iter big(make_oversized(l.begin()));
+    REQUIRE(*++big == 2);
+    REQUIRE(big == Iter(make_oversized(--l.end())));
+    big = vc.begin();
+    REQUIRE(*big == 5);
+
+    // empty iterators and other wrapped types
+    REQUIRE(Iter() == Iter());
+    REQUIRE(Iter() != last);
+    REQUIRE(Iter(l.begin()) != Iter(vc.begin()));
+}
+
+TEST_CASE("dispatch policies", "[basic]")
+{
+    SECTION("function table")
+    {
+        static_assert(sizeof(tyti::any_iterator<int, tyti::table_dispatch>) == sizeof(tyti::any_iterator<int>),
+            "the function table is the default");
+        check_dispatch<tyti::any_iterator<int, tyti::table_dispatch>>();
+    }
+
+    SECTION("inline")
+    {
+        using inline_iterator = tyti::any_iterator<int, tyti::inline_dispatch>;
+        static_assert(sizeof(inline_iterator) == sizeof(tyti::any_iterator<int>) + 3 * sizeof(void*),
+            "hot entries are stored inside of the any_iterator");
+        check_dispatch<inline_iterator>();
+    }
+
+    SECTION("virtual")
+    {
+        using virtual_iterator = tyti::any_iterator<int, tyti::virtual_dispatch>;
+        static_assert(sizeof(virtual_iterator) == sizeof(tyti::any_iterator<int>) + sizeof(void*),
+            "the entries object is stored next to the table");
+        check_dispatch<virtual_iterator>();
+    }
+
+    SECTION("switch")
+    {
+        using switch_iterator = tyti::any_iterator<int,
+            tyti::switch_dispatch<std::vector<int>::iterator, std::list<int>::iterator>>;
+        static_assert(sizeof(switch_iterator) == sizeof(tyti::any_iterator<int>) + sizeof(std::size_t),
+            "the index is stored next to the table");
+        check_dispatch<switch_iterator>();
+
+        // random access, types which are not listed go through the table
+        using ra_iterator = tyti::any_iterator<int, std::random_access_iterator_tag, tyti::switch_dispatch<int*>>;
+        int arr[] = { 1, 2, 3 };
+        std::vector<int> v = { 4, 5 };
+        ra_iterator a(arr + 0);
+        REQUIRE(a[2] == 3);
+        REQUIRE(std::accumulate(a, ra_iterator(arr + 3), 0) == 6);
+        a = v.begin();
+        REQUIRE(std::accumulate(a, ra_iterator(v.end()), 0) == 9);
+    }
+}
+
+TEST_CASE("instrumentation counters", "[basic]")
+{
+    std::vector<long> vc = { 5,10,20 };
+    using counted_iterator = tyti::any_iterator<long, tyti::count_stats>;
+    using small_t = std::vector<long>::iterator;
+    using big_t = oversized<std::vector<long>::iterator>;
+
+    counted_iterator it(vc.begin());
+    counted_iterator last(vc.end());
+    tyti::reset_iterator_stats();
+
+    // counters are registered on first use
+    for (; it != last; ++it) {}
+    const tyti::iterator_stats& small = stats_of<small_t>();
+    REQUIRE_FALSE(small.heap);
+    REQUIRE(small.inc == 3);
+    REQUIRE(small.equal == 4);
+    REQUIRE(small.deref == 0);
+
+    counted_iterator cpy(--it);
+    counted_iterator moved(std::move(cpy));
+    REQUIRE(*moved == 20);
+    REQUIRE(small.dec == 1);
+    REQUIRE(small.copies == 1);
+    REQUIRE(small.moves == 1);
+    REQUIRE(small.deref == 1);
+    REQUIRE(small.heap_allocations == 0);
+
+    it = make_oversized(vc.begin());
+    const tyti::iterator_stats& big = stats_of<big_t>();
+    REQUIRE(big.heap);
+    REQUIRE(big.type_switches == 1);
+    REQUIRE(big.heap_allocations == 1);
+    // the same type is assigned in place
+    it = make_oversized(vc.begin());
+    REQUIRE(big.heap_allocations == 1);
+    REQUIRE(big.reallocations == 0);
+    it = make_oversized(vc.data());
+    const tyti::iterator_stats& big_ptr = stats_of<oversized<long*>>();
+    REQUIRE(big_ptr.reallocations == 1);
+    REQUIRE(big_ptr.heap_allocations == 1);
+    REQUIRE(big.heap_deallocations == 1);
+    it = make_oversized(vc.begin());
+    REQUIRE(big.heap_allocations == 2);
+    it = vc.begin();
+    REQUIRE(small.type_switches == 1);
+    REQUIRE(big.heap_deallocations == 2);
+
+    std::ostringstream out;
+    tyti::write_iterator_stats(out);
+    REQUIRE(out.str().find("heap_allocations: 2") != std::string::npos);
+}
+
+// visitors for the visit test case
+struct sum_visitor
+{
+    using result_type = long;
+    template<typename Iter>
+    long operator()(Iter& _first, const Iter& _last) const
+    {
+        return std::accumulate(_first, _last, 0L);
+    }
+};
+
+struct skip_visitor
+{
+    std::size_t skipped = 0;
+    template<typename Iter>
+    void operator()(Iter& _first, const Iter& _last)
+    {
+        for (; _first != _last && *_first < 10; ++_first)
+            ++skipped;
+    }
+};
+
+TEST_CASE("visit", "[basic]")
+{
+    using visit_iterator = tyti::any_iterator<int, tyti::visitors<sum_visitor, skip_visitor>>;
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> l = { 1,2,3,40 };
+
+    visit_iterator first(vc.begin());
+    visit_iterator last(vc.end());
+    REQUIRE(tyti::visit(first, last, sum_visitor()) == 35);
+
+    // the native first iterator is advanced in place
+    skip_visitor skip;
+    tyti::visit(first, last, skip);
+    REQUIRE(skip.skipped == 1);
+    REQUIRE(*first == 10);
+
+    first = l.begin();
+    last = l.end();
+    REQUIRE(tyti::visit(first, last, sum_visitor()) == 46);
+    tyti::visit(first, last, skip);
+    REQUIRE(skip.skipped == 4);
+    REQUIRE(*first == 40);
+
+    // heap stored iterators
+    first = make_oversized(l.begin());
+    last = make_oversized(l.end());
+    REQUIRE(tyti::visit(first, last, sum_visitor()) == 46);
+}
+
+// counts the calls of operator* of the wrapped iterator, used by the deref cache test case
+template<typename Iter, int Tag = 0>
+struct deref_counting_iterator
+{
+    using iterator_category = typename std::iterator_traits<Iter>::iterator_category;
+    using value_type = typename std::iterator_traits<Iter>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::iterator_traits<Iter>::pointer;
+    using reference = typename std::iterator_traits<Iter>::reference;
+
+    static int derefs;
+
+    Iter it;
+
+    reference operator*() const { ++derefs; return *it; }
+    reference operator[](std::ptrdiff_t _n) const { return it[_n]; }
+    deref_counting_iterator& operator++() { ++it; return *this; }
+    deref_counting_iterator& operator--() { --it; return *this; }
+    deref_counting_iterator& operator+=(std::ptrdiff_t _n) { it += _n; return *this; }
+    std::ptrdiff_t operator-(const deref_counting_iterator& _rhs) const { return it - _rhs.it; }
+    bool operator==(const deref_counting_iterator& _rhs) const { return it == _rhs.it; }
+    bool operator!=(const deref_counting_iterator& _rhs) const { return it != _rhs.it; }
+    bool operator<(const deref_counting_iterator& _rhs) const { return it < _rhs.it; }
+};
+template<typename Iter, int Tag> int deref_counting_iterator<Iter, Tag>::derefs = 0;
+
+// the element can be changed behind the iterator, dereferenced every time
+using impure_iterator = deref_counting_iterator<std::vector<int>::iterator, 1>;
+
+namespace tyti {
+template<>
+struct is_pure_deref<impure_iterator> : std::false_type {};
+} // end namespace tyti
+
+TEST_CASE("deref cache", "[basic]")
+{
+    std::vector<int> vc = { 5, 10, 20 };
+
+    SECTION("addresses")
+    {
+        using cached_iterator = tyti::any_iterator<int, std::random_access_iterator_tag, tyti::cache_deref>;
+        using counted = deref_counting_iterator<std::vector<int>::iterator>;
+        static_assert(sizeof(cached_iterator) == sizeof(tyti::any_iterator<int>) + sizeof(void*), "one pointer");
+        counted::derefs = 0;
+
+        cached_iterator it(counted{ vc.begin() });
+        REQUIRE(*it == 5);
+        REQUIRE(&*it == &vc[0]);
+        REQUIRE(*it + *it == 10);
+        REQUIRE(counted::derefs == 1);
+
+        ++it;
+        REQUIRE(*it == 10);
+        REQUIRE(counted::derefs == 2);
+        --it;
+        REQUIRE(*it == 5);
+        it += 2;
+        REQUIRE(*it == 20);
+        REQUIRE(counted::derefs == 4);
+        it++;
+        it--;
+        REQUIRE(*it == 20);
+        REQUIRE(counted::derefs == 5);
+
+        // copies dereference again, assignments drop the cache
+        cached_iterator cpy(it);
+        REQUIRE(*cpy == 20);
+        REQUIRE(counted::derefs == 6);
+        cpy = counted{ vc.begin() };
+        REQUIRE(*cpy == 5);
+        REQUIRE(counted::derefs == 7);
+        cpy = it;
+        REQUIRE(*cpy == 20);
+        REQUIRE(counted::derefs == 8);
+
+        // not cached for other wrapped types
+        it = vc.begin();
+        REQUIRE(*it == 5);
+        REQUIRE(counted::derefs == 8);
+    }
+
+    SECTION("values")
+    {
+        using value_iterator = tyti::any_iterator<int, std::random_access_iterator_tag, tyti::by_value, tyti::cache_deref>;
+        using counted = deref_counting_iterator<counting_iterator>;
+        counted::derefs = 0;
+
+        value_iterator it(counted{ counting_iterator{ 3 } });
+        const value_iterator last(counted{ counting_iterator{ 6 } });
+        REQUIRE(*it == 3);
+        REQUIRE(*it == 3);
+        REQUIRE(counted::derefs == 1);
+        REQUIRE(*it++ == 3); // the returned copy dereferences again
+        REQUIRE(*it == 4);
+        REQUIRE(counted::derefs == 3);
+        REQUIRE(std::find(it, last, 5) != last);
+        REQUIRE(*std::lower_bound(it, last, 5) == 5);
+
+        std::vector<std::pair<int, int>> vp = { { 1, 2 } };
+        using pair_counted = deref_counting_iterator<std::vector<std::pair<int, int>>::iterator>;
+        pair_counted::derefs = 0;
+        tyti::any_iterator<std::pair<int, int>, tyti::by_value, tyti::cache_deref> pit(pair_counted{ vp.begin() });
+        REQUIRE(pit->first + pit->second == 3);
+        REQUIRE(pair_counted::derefs == 1);
+    }
+
+    SECTION("impure types are not cached")
+    {
+        impure_iterator::derefs = 0;
+        tyti::any_iterator<int&, tyti::cache_deref> it(impure_iterator{ vc.begin() });
+        REQUIRE(*it == 5);
+        *it = 6;
+        REQUIRE(*it == 6);
+        REQUIRE(impure_iterator::derefs == 3);
+    }
+
+    SECTION("visit and next_block drop the cache")
+    {
+        using cached_iterator = tyti::any_iterator<int, std::forward_iterator_tag, tyti::cache_deref, tyti::visitors<skip_visitor>>;
+        cached_iterator it(vc.begin());
+        const cached_iterator last(vc.end());
+        REQUIRE(*it == 5);
+        tyti::visit(it, last, skip_visitor());
+        REQUIRE(*it == 10);
+        const int* block[2];
+        REQUIRE(it.next_block(last, block, 1) == 1);
+        REQUIRE(*it == 20);
+    }
+}
+
+TEST_CASE("bitwise equality and sentinel", "[basic]")
+{
+    static_assert(tyti::is_bitwise_comparable<const int*>::value, "pointers are bitwise comparable");
+    static_assert(!tyti::is_bitwise_comparable<std::list<int>::iterator>::value, "list iterators are not");
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+    static_assert(tyti::is_bitwise_comparable<std::vector<int>::iterator>::value, "vector iterators are");
+#endif
+
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> l = { 1,2 };
+    int arr[] = { 1,2,3 };
+
+    SECTION("equality")
+    {
+        tyti::any_iterator<int> a(vc.begin()), b(vc.begin());
+        REQUIRE(a == b);
+        REQUIRE(++a != b);
+        REQUIRE(a == ++b);
+        REQUIRE(a == vc.begin() + 1);
+
+        // same bytes, but different wrapped types
+        tyti::any_iterator<int> p(vc.data() + 1);
+        REQUIRE(p != a);
+        REQUIRE(p == tyti::any_iterator<int>(&vc[1]));
+
+        tyti::any_iterator<int, tyti::inline_dispatch> ia(arr + 0), ib(arr + 3);
+        REQUIRE(std::distance(ia, ib) == 3);
+        REQUIRE(ia != ib);
+    }
+
+    SECTION("sentinel")
+    {
+        tyti::any_iterator<int> it(vc.begin());
+        const tyti::any_sentinel<int> end(tyti::any_iterator<int>(vc.end()));
+        int sum = 0;
+        for (; it != end; ++it)
+            sum += *it;
+        REQUIRE(sum == 35);
+        REQUIRE(end == it);
+        REQUIRE(end.base() == it);
+
+        // not bitwise comparable and heap stored types
+        it = l.begin();
+        const tyti::any_sentinel<int> lend(tyti::any_iterator<int>(l.end()));
+        REQUIRE(std::distance(it, tyti::any_iterator<int>(l.end())) == 2);
+        REQUIRE(it != lend);
+        REQUIRE(++++it == lend);
+        REQUIRE(it != end);
+
+        tyti::any_iterator<int> big(make_oversized(l.begin()));
+        const tyti::any_sentinel<int> bend(tyti::any_iterator<int>(make_oversized(l.end())));
+        REQUIRE(big != bend);
+        REQUIRE(++++big == bend);
+    }
+}
+
+// counts the copies and moves of the shared state, like iterators of a shared buffer
+template<typename Iter, std::size_t Padding>
+struct shared_iterator
+{
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename std::iterator_traits<Iter>::value_type;
+    using difference_type = typename std::iterator_traits<Iter>::difference_type;
+    using pointer = typename std::iterator_traits<Iter>::pointer;
+    using reference = typename std::iterator_traits<Iter>::reference;
+
+    static int copies;
+    static int moves;
+
+    Iter it;
+    std::shared_ptr<int> state;
+    char padding[Padding];
+
+    shared_iterator(Iter _it, std::shared_ptr<int> _state) : it(_it), state(std::move(_state)) {}
+    shared_iterator(const shared_iterator& _rhs) : it(_rhs.it), state(_rhs.state) { ++copies; }
+    shared_iterator(shared_iterator&& _rhs) noexcept : it(_rhs.it), state(std::move(_rhs.state)) { ++moves; }
+    shared_iterator& operator=(const shared_iterator& _rhs) { it = _rhs.it; state = _rhs.state; ++copies; return *this; }
+    shared_iterator& operator=(shared_iterator&& _rhs) noexcept { it = _rhs.it; state = std::move(_rhs.state); ++moves; return *this; }
+    shared_iterator& operator++() { ++it; return *this; }
+    shared_iterator& operator--() { --it; return *this; }
+    bool operator==(const shared_iterator& _rhs) const { return it == _rhs.it; }
+    bool operator!=(const shared_iterator& _rhs) const { return it != _rhs.it; }
+    reference operator*() const { return *it; }
+};
+template<typename Iter, std::size_t Padding>
+int shared_iterator<Iter, Padding>::copies = 0;
+template<typename Iter, std::size_t Padding>
+int shared_iterator<Iter, Padding>::moves = 0;
+
+template<typename TestType>
+void check_move_semantics()
+{
+    std::vector<int> vc = { 5,10,20 };
+    auto state = std::make_shared<int>(0);
+    TestType::copies = 0;
+    TestType::moves = 0;
+
+    tyti::any_iterator<int> it(TestType(vc.begin(), state));
+    REQUIRE(TestType::copies == 0);
+    REQUIRE(state.use_count() == 2);
+    REQUIRE(*it == 5);
+
+    // same type, assigned in place
+    it = TestType(vc.begin() + 1, state);
+    REQUIRE(TestType::copies == 0);
+    REQUIRE(state.use_count() == 2);
+    REQUIRE(*it == 10);
+
+    // moves of the any_iterator do not touch the shared state
+    const int moves = TestType::moves;
+    tyti::any_iterator<int> moved(std::move(it));
+    it = std::move(moved);
+    REQUIRE(TestType::copies == 0);
+    REQUIRE(state.use_count() == 2);
+    REQUIRE(*it == 10);
+    if (sizeof(TestType) > 4 * sizeof(void*))
+        REQUIRE(TestType::moves == moves); // the heap block is stolen
+
+    TestType lvalue(vc.begin(), state);
+    it = vc.begin();
+    it = lvalue;
+    REQUIRE(TestType::copies == 1);
+    REQUIRE(state.use_count() == 3);
+
+    // copy assignment of the same type is done in place
+    const tyti::any_iterator<int> other(TestType(vc.begin() + 2, state));
+    const int copies = TestType::copies;
+    it = other;
+    REQUIRE(TestType::copies == copies + 1);
+    REQUIRE(*it == 20);
+    REQUIRE(state.use_count() == 4);
+
+    tyti::any_range<int> r(TestType(vc.begin(), state), TestType(vc.end(), state));
+    REQUIRE(TestType::copies == copies + 1);
+    REQUIRE(r.accumulate(0) == 35);
+}
+
+TEST_CASE("move semantics", "[basic]")
+{
+    SECTION("inline") { check_move_semantics<shared_iterator<std::vector<int>::iterator, 1>>(); }
+    SECTION("heap") { check_move_semantics<shared_iterator<std::vector<int>::iterator, 64>>(); }
+}
+
+TEST_CASE("prefetch iterator", "[basic]")
+{
+    std::list<int> l = { 1,2,3,4,5 };
+    using forward_iterator = tyti::any_iterator<int, std::forward_iterator_tag>;
+
+    // window smaller and bigger than the range
+    forward_iterator it(tyti::make_prefetch_iterator<2>(l.begin(), l.end()));
+    const forward_iterator last(tyti::make_prefetch_iterator<2>(l.end(), l.end()));
+    REQUIRE(std::accumulate(it, last, 0) == 15);
+    REQUIRE(*it++ == 1);
+    REQUIRE(*it == 2);
+
+    auto big = tyti::make_prefetch_iterator<16>(l.begin(), l.end());
+    REQUIRE(std::distance(big, tyti::make_prefetch_iterator<16>(l.end(), l.end())) == 5);
+    REQUIRE(std::next(big, 4).base() == std::prev(l.end()));
+
+    std::map<int, int> m = { {1, 10}, {2, 20} };
+    auto mit = tyti::make_prefetch_iterator<4>(m.begin(), m.end());
+    REQUIRE(mit->second == 10);
+    REQUIRE((++mit)->second == 20);
+}
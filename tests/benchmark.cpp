@@ -1,116 +1,479 @@
 #include <benchmark/benchmark.h>
 
 #include <vector>
+#include <deque>
 #include <list>
+#include <forward_list>
+#include <set>
 #include <map>
+#include <unordered_map>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
-#include <ctime>
+#include <iterator>
+#include <memory>
 #include <numeric>
+#include <random>
 
 #include "any_iterator.hpp"
+#include "prefetch_iterator.hpp"
+#include "any_range.hpp"
+#include "variant_iterator.hpp"
 #include "any_iterator_virtual.hpp"
 
-template< class IterT, class ContainerT >
-void benchmark_iteration(benchmark::State &state)
+// vector whose iterator is too big for the inline buffer of any_iterator,
+// so the heap path (allocation on copy) is measured.
+struct padded_vector
 {
-    using Iter = IterT;
+    struct const_iterator
+    {
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
 
-    for (auto _ : state)
+        std::vector<int>::const_iterator it;
+        char padding[64];
+
+        const_iterator& operator++() { ++it; return *this; }
+        const_iterator operator++(int) { const_iterator cpy(*this); ++it; return cpy; }
+        const_iterator& operator--() { --it; return *this; }
+        const_iterator operator--(int) { const_iterator cpy(*this); --it; return cpy; }
+        const_iterator& operator+=(difference_type _n) { it += _n; return *this; }
+        const_iterator operator+(difference_type _n) const { const_iterator cpy(*this); cpy.it += _n; return cpy; }
+        difference_type operator-(const const_iterator& _rhs) const { return it - _rhs.it; }
+        reference operator[](difference_type _n) const { return it[_n]; }
+        reference operator*() const { return *it; }
+        pointer operator->() const { return &*it; }
+        bool operator==(const const_iterator& _rhs) const { return it == _rhs.it; }
+        bool operator!=(const const_iterator& _rhs) const { return it != _rhs.it; }
+        bool operator<(const const_iterator& _rhs) const { return it < _rhs.it; }
+    };
+    using value_type = int;
+
+    std::vector<int> data;
+
+    const_iterator begin() const { return const_iterator{ data.begin(), {} }; }
+    const_iterator end() const { return const_iterator{ data.end(), {} }; }
+};
+
+// vector of pointers to ints scattered over a pool (an index of a big table),
+// the iteration is cheap, but every dereference may miss the cache
+struct indirect_vector
+{
+    struct const_iterator
     {
-        state.PauseTiming();
-        ContainerT container(state.range(0));
-        srand(static_cast<unsigned>(time(NULL)));
-        for (auto& v : container)
-            v = rand();
-        volatile int result = 0;
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
 
-        Iter it{ container.begin() };
-        const Iter it_end{ container.end() };
+        std::vector<const int*>::const_iterator it;
 
-        state.ResumeTiming();
-        int intm = 0;
-        for (; it != it_end; ++it)
-            intm += *it;
-        result = intm;
-    }
+        const_iterator& operator++() { ++it; return *this; }
+        const_iterator operator++(int) { const_iterator cpy(*this); ++it; return cpy; }
+        const_iterator& operator--() { --it; return *this; }
+        const_iterator operator--(int) { const_iterator cpy(*this); --it; return cpy; }
+        const_iterator& operator+=(difference_type _n) { it += _n; return *this; }
+        const_iterator operator+(difference_type _n) const { const_iterator cpy(*this); cpy.it += _n; return cpy; }
+        difference_type operator-(const const_iterator& _rhs) const { return it - _rhs.it; }
+        reference operator[](difference_type _n) const { return *it[_n]; }
+        reference operator*() const { return **it; }
+        pointer operator->() const { return *it; }
+        bool operator==(const const_iterator& _rhs) const { return it == _rhs.it; }
+        bool operator!=(const const_iterator& _rhs) const { return it != _rhs.it; }
+        bool operator<(const const_iterator& _rhs) const { return it < _rhs.it; }
+    };
+    using value_type = int;
 
+    std::vector<int> pool;
+    std::vector<const int*> data;
 
-    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+    const_iterator begin() const { return const_iterator{ data.begin() }; }
+    const_iterator end() const { return const_iterator{ data.end() }; }
+};
+
+using int_vector = std::vector<int>;
+using int_deque = std::deque<int>;
+using int_list = std::list<int>;
+using int_forward_list = std::forward_list<int>;
+using int_set = std::set<int>;
+using int_map = std::map<int, int>;
+using int_unordered_map = std::unordered_map<int, int>;
+// list whose nodes are linked in random order, like a list after many inserts and erases
+struct shuffled_list : std::list<int> {};
+
+// containers with random content
+template<class ContainerT>
+void fill(ContainerT& _c, std::size_t _n)
+{
+    _c = ContainerT(_n);
+    for (auto& v : _c)
+        v = rand();
+}
+
+inline void fill(padded_vector& _c, std::size_t _n) { fill(_c.data, _n); }
+
+inline void fill(indirect_vector& _c, std::size_t _n)
+{
+    // one int per cache line, so every element is a separate miss
+    const std::size_t stride = 64 / sizeof(int);
+    fill(_c.pool, _n * stride);
+    _c.data.resize(_n);
+    for (std::size_t i = 0; i < _n; ++i)
+        _c.data[i] = &_c.pool[i * stride];
+    std::shuffle(_c.data.begin(), _c.data.end(), std::mt19937(42));
+}
+
+inline void fill(int_set& _c, std::size_t _n)
+{
+    for (std::size_t i = 0; i < _n; ++i)
+        _c.insert(static_cast<int>(i));
+}
+
+template<class MapT>
+void fill_map(MapT& _c, std::size_t _n)
+{
+    for (std::size_t i = 0; i < _n; ++i)
+        _c.emplace(static_cast<int>(i), rand());
+}
+
+inline void fill(int_map& _c, std::size_t _n) { fill_map(_c, _n); }
+
+inline void fill(shuffled_list& _c, std::size_t _n)
+{
+    fill(static_cast<int_list&>(_c), _n);
+    std::vector<int_list::const_iterator> nodes;
+    nodes.reserve(_n);
+    for (auto it = _c.cbegin(); it != _c.cend(); ++it)
+        nodes.push_back(it);
+    std::shuffle(nodes.begin(), nodes.end(), std::mt19937(42));
+    for (auto node : nodes)
+        _c.splice(_c.end(), _c, node);
 }
+inline void fill(int_unordered_map& _c, std::size_t _n) { fill_map(_c, _n); }
 
-template< class IterT, class ContainerT >
-void benchmark_iteration_accumulate(benchmark::State &state)
+// containers are built once per size outside of the timed loop and shared by all
+// benchmarks of the same container, so the setup does not add noise to small sizes.
+template<class ContainerT>
+class container_fixture
 {
-    using Iter = IterT;
+public:
+    static const ContainerT& get(std::size_t _n)
+    {
+        static std::unique_ptr<ContainerT> container;
+        static std::size_t size = 0;
+        if (!container || size != _n)
+        {
+            container.reset(); // free the old container first, big sizes need a lot of memory
+            srand(42);
+            std::unique_ptr<ContainerT> c(new ContainerT());
+            fill(*c, _n);
+            container = std::move(c);
+            size = _n;
+        }
+        return *container;
+    }
+};
+
+inline int value_of(int _v) { return _v; }
+inline int value_of(const std::pair<const int, int>& _v) { return _v.second; }
+
+template<class ContainerT>
+using native_iter = typename ContainerT::const_iterator;
+
+template<class ContainerT>
+using any_iter = tyti::any_iterator<typename ContainerT::value_type,
+    typename std::iterator_traits<native_iter<ContainerT>>::iterator_category>;
 
+template<class ContainerT>
+using virtual_iter = tyti::any_iterator_virtual<typename ContainerT::value_type,
+    typename std::iterator_traits<native_iter<ContainerT>>::iterator_category>;
+
+// the container's iterator is inlined, all others go through the function table
+template<class ContainerT>
+using switch_iter = tyti::any_iterator<typename ContainerT::value_type,
+    typename std::iterator_traits<native_iter<ContainerT>>::iterator_category, tyti::switch_dispatch<native_iter<ContainerT>>>;
+
+template<class ContainerT>
+using inline_iter = tyti::any_iterator<typename ContainerT::value_type,
+    typename std::iterator_traits<native_iter<ContainerT>>::iterator_category, tyti::inline_dispatch>;
+
+/// ++, != and * per element
+template<class IterT, class ContainerT>
+void benchmark_iteration(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
     for (auto _ : state)
     {
-        state.PauseTiming();
-        ContainerT container(state.range(0));
-        srand(static_cast<unsigned>(time(NULL)));
-        for (auto& v : container)
-            v = rand();
-        volatile int result = 0;
+        IterT it{ container.begin() };
+        const IterT it_end{ container.end() };
+        int sum = 0;
+        for (; it != it_end; ++it)
+            sum += value_of(*it);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
+/// ++, != and * per element, the end is a tyti::any_sentinel
+template<class ContainerT>
+void benchmark_sentinel(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    using Iter = any_iter<ContainerT>;
+    for (auto _ : state)
+    {
         Iter it{ container.begin() };
-        const Iter it_end{ container.end() };
+        const tyti::any_sentinel<typename ContainerT::value_type, typename std::iterator_traits<native_iter<ContainerT>>::iterator_category>
+            it_end{ Iter{ container.end() } };
+        int sum = 0;
+        for (; it != it_end; ++it)
+            sum += value_of(*it);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
-        state.ResumeTiming();
-        result = std::accumulate(it, it_end, 0);
+/// benchmark_iteration with a tyti::prefetch_iterator inside of the any_iterator, compare with
+/// benchmark_iteration<any_iter<ContainerT>, ContainerT>
+template<class ContainerT, std::size_t Distance>
+void benchmark_prefetch(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    using Iter = tyti::any_iterator<typename ContainerT::value_type, std::forward_iterator_tag>;
+    for (auto _ : state)
+    {
+        Iter it{ tyti::make_prefetch_iterator<Distance>(container.begin(), container.end()) };
+        const Iter it_end{ tyti::make_prefetch_iterator<Distance>(container.end(), container.end()) };
+        int sum = 0;
+        for (; it != it_end; ++it)
+            sum += value_of(*it);
+        benchmark::DoNotOptimize(sum);
     }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
+/// *it++ per element, copies the iterator for every element
+template<class IterT, class ContainerT>
+void benchmark_post_increment(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    for (auto _ : state)
+    {
+        IterT it{ container.begin() };
+        const IterT it_end{ container.end() };
+        int sum = 0;
+        while (it != it_end)
+            sum += value_of(*it++);
+        benchmark::DoNotOptimize(sum);
+    }
     state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
 }
 
-template< class IterT >
-void benchmark_iteration_map(benchmark::State &state)
+/// copy construction of the iterator per element
+template<class IterT, class ContainerT>
+void benchmark_copy(benchmark::State& state)
 {
-    using Iter = IterT;
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    for (auto _ : state)
+    {
+        IterT it{ container.begin() };
+        const IterT it_end{ container.end() };
+        int sum = 0;
+        for (; it != it_end; ++it)
+        {
+            const IterT cpy(it);
+            sum += value_of(*cpy);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
+/// copy assignment of the iterator (same wrapped type) per element
+template<class IterT, class ContainerT>
+void benchmark_assign(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
     for (auto _ : state)
     {
-        state.PauseTiming();
-        std::map<int,int> container;
-        srand(static_cast<unsigned>(time(NULL)));
-        for (size_t i = 0; i < state.range(0); ++i)
-            container.emplace(static_cast<int>(i), rand());
-        volatile int result = 0;
+        IterT it{ container.begin() };
+        const IterT it_end{ container.end() };
+        IterT dst{ container.begin() };
+        int sum = 0;
+        for (; it != it_end; ++it)
+        {
+            dst = it;
+            sum += value_of(*dst);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
-        Iter it{ container.begin() };
-        const Iter it_end{ container.end() };
+/// std::accumulate and std::count_if over the whole range
+template<class IterT, class ContainerT>
+void benchmark_algorithms(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    using value_type = typename ContainerT::value_type;
+    for (auto _ : state)
+    {
+        const IterT first{ container.begin() };
+        const IterT last{ container.end() };
+        const int sum = std::accumulate(first, last, 0, [](int _acc, const value_type& _v) { return _acc + value_of(_v); });
+        const auto odd = std::count_if(first, last, [](const value_type& _v) { return value_of(_v) % 2 != 0; });
+        benchmark::DoNotOptimize(sum);
+        benchmark::DoNotOptimize(odd);
+    }
+    state.SetItemsProcessed(2 * state.iterations() * int64_t(state.range(0)));
+}
 
-        state.ResumeTiming();
-        int intm = 0;
-        for (; it != it_end; ++it)
-            intm += it->second;
-        result = intm;
+/// tyti::for_each, dispatches per block instead of per element
+template<class ContainerT>
+void benchmark_for_each(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    using Iter = any_iter<ContainerT>;
+    for (auto _ : state)
+    {
+        int sum = 0;
+        tyti::for_each(Iter{ container.begin() }, Iter{ container.end() }, [&sum](int v) { sum += v; });
+        benchmark::DoNotOptimize(sum);
     }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
+
+/// any_range::accumulate, a single dispatch for the whole range
+template<class ContainerT>
+void benchmark_range_accumulate(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    const tyti::any_range<typename ContainerT::value_type, std::forward_iterator_tag> range{ container.begin(), container.end() };
+    for (auto _ : state)
+        benchmark::DoNotOptimize(range.accumulate(0));
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
+
+struct accumulate_visitor
+{
+    using result_type = int;
+    template<class Iter>
+    int operator()(Iter& first, const Iter& last) const { return std::accumulate(first, last, 0); }
+};
+
+/// tyti::visit, a single dispatch, std::accumulate runs on the native iterators
+template<class ContainerT>
+void benchmark_visit(benchmark::State& state)
+{
+    const ContainerT& container = container_fixture<ContainerT>::get(state.range(0));
+    using Iter = tyti::any_iterator<typename ContainerT::value_type, std::forward_iterator_tag,
+        tyti::visitors<accumulate_visitor>>;
+    Iter first{ container.begin() };
+    const Iter last{ container.end() };
+    for (auto _ : state)
+        benchmark::DoNotOptimize(tyti::visit(first, last, accumulate_visitor()));
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
+}
 
-    state.SetItemsProcessed(state.iterations() *  int64_t(state.range(0)));
+/// assigns an iterator of another type to the same any_iterator for every element,
+/// alternating between a std::vector and a ContainerT iterator
+template<class IterT, class ContainerT>
+void benchmark_type_switch(benchmark::State& state)
+{
+    const int_vector& vc = container_fixture<int_vector>::get(state.range(0));
+    const ContainerT& other = container_fixture<ContainerT>::get(state.range(0));
+    for (auto _ : state)
+    {
+        IterT it{ vc.begin() };
+        int sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            if (i & 1)
+                it = vc.begin();
+            else
+                it = other.begin();
+            sum += *it;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(state.range(0)));
 }
 
-constexpr size_t MY_RANGE_START = 8 << 0;
-constexpr size_t MY_RANGE_END = 8 << 20;
+constexpr int64_t MY_RANGE_START = 8 << 0;
+constexpr int64_t MY_RANGE_END = 8 << 18;
 constexpr benchmark::TimeUnit tu = benchmark::kMicrosecond;
-constexpr size_t range_multi = 2;
+constexpr int range_multi = 8;
+
+#define ANY_ITER_BENCHMARK(func, ...) \
+    BENCHMARK_TEMPLATE(func, __VA_ARGS__)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi)
+
+// native vs any_iterator for forward containers
+#define ANY_ITER_BENCHMARK_FORWARD(func, ContainerT) \
+    ANY_ITER_BENCHMARK(func, native_iter<ContainerT>, ContainerT); \
+    ANY_ITER_BENCHMARK(func, any_iter<ContainerT>, ContainerT)
+
+// native vs any_iterator vs any_iterator_virtual
+#define ANY_ITER_BENCHMARK_ALL(func, ContainerT) \
+    ANY_ITER_BENCHMARK_FORWARD(func, ContainerT); \
+    ANY_ITER_BENCHMARK(func, virtual_iter<ContainerT>, ContainerT)
+
+#define ANY_ITER_BENCHMARK_CONTAINERS(func) \
+    ANY_ITER_BENCHMARK_ALL(func, int_vector); \
+    ANY_ITER_BENCHMARK_ALL(func, int_deque); \
+    ANY_ITER_BENCHMARK_ALL(func, int_list); \
+    ANY_ITER_BENCHMARK_ALL(func, int_forward_list); \
+    ANY_ITER_BENCHMARK_ALL(func, int_set); \
+    ANY_ITER_BENCHMARK_ALL(func, int_map); \
+    ANY_ITER_BENCHMARK_ALL(func, int_unordered_map); \
+    ANY_ITER_BENCHMARK_ALL(func, padded_vector)
+
+ANY_ITER_BENCHMARK_CONTAINERS(benchmark_iteration);
+ANY_ITER_BENCHMARK(benchmark_iteration, inline_iter<int_list>, int_list);
+ANY_ITER_BENCHMARK(benchmark_iteration, inline_iter<int_map>, int_map);
+ANY_ITER_BENCHMARK(benchmark_iteration, inline_iter<int_vector>, int_vector);
+ANY_ITER_BENCHMARK(benchmark_iteration, switch_iter<int_vector>, int_vector);
+ANY_ITER_BENCHMARK(benchmark_iteration, switch_iter<int_list>, int_list);
+ANY_ITER_BENCHMARK(benchmark_iteration, switch_iter<int_map>, int_map);
+
+ANY_ITER_BENCHMARK(benchmark_sentinel, int_vector);
+ANY_ITER_BENCHMARK(benchmark_sentinel, int_list);
 
-//BENCHMARK_TEMPLATE(benchmark_iteration, std::vector<int>::iterator, std::vector<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-//BENCHMARK_TEMPLATE(benchmark_iteration, tyti::any_iterator<int>, std::vector<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-//BENCHMARK_TEMPLATE(benchmark_iteration, tyti::any_iterator_virtual<int>, std::vector<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
+ANY_ITER_BENCHMARK_FORWARD(benchmark_iteration, shuffled_list);
+ANY_ITER_BENCHMARK_FORWARD(benchmark_iteration, indirect_vector);
+ANY_ITER_BENCHMARK(benchmark_prefetch, indirect_vector, 4);
+ANY_ITER_BENCHMARK(benchmark_prefetch, indirect_vector, 16);
+ANY_ITER_BENCHMARK(benchmark_prefetch, int_list, 4);
+ANY_ITER_BENCHMARK(benchmark_prefetch, int_list, 16);
+ANY_ITER_BENCHMARK(benchmark_prefetch, shuffled_list, 4);
+ANY_ITER_BENCHMARK(benchmark_prefetch, shuffled_list, 16);
+ANY_ITER_BENCHMARK(benchmark_prefetch, int_map, 4);
+ANY_ITER_BENCHMARK(benchmark_prefetch, int_map, 16);
 
-BENCHMARK_TEMPLATE(benchmark_iteration, std::list<int>::iterator, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-BENCHMARK_TEMPLATE(benchmark_iteration, tyti::any_iterator<int>, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-BENCHMARK_TEMPLATE(benchmark_iteration, tyti::any_iterator_virtual<int>, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
+ANY_ITER_BENCHMARK_CONTAINERS(benchmark_algorithms);
+ANY_ITER_BENCHMARK_CONTAINERS(benchmark_post_increment);
+ANY_ITER_BENCHMARK_CONTAINERS(benchmark_copy);
+ANY_ITER_BENCHMARK_CONTAINERS(benchmark_assign);
 
-//BENCHMARK_TEMPLATE(benchmark_iteration_accumulate, std::vector<int>::iterator, std::vector<int>)->Range(MY_RANGE_START, MY_RANGE_END);
-////BENCHMARK_TEMPLATE(benchmark_iteration_accumulate, tyti::any_iterator<int>, std::vector<int>)->Range(MY_RANGE_START, MY_RANGE_END);
-//BENCHMARK_TEMPLATE(benchmark_iteration_accumulate, std::list<int>::iterator, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu);
-//BENCHMARK_TEMPLATE(benchmark_iteration_accumulate, tyti::any_iterator<int>, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu);
-//BENCHMARK_TEMPLATE(benchmark_iteration_accumulate, tyti2::any_iterator<int>, std::list<int>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu);
+ANY_ITER_BENCHMARK(benchmark_for_each, int_vector);
+ANY_ITER_BENCHMARK(benchmark_for_each, int_list);
+ANY_ITER_BENCHMARK(benchmark_for_each, int_forward_list);
+ANY_ITER_BENCHMARK(benchmark_range_accumulate, int_vector);
+ANY_ITER_BENCHMARK(benchmark_range_accumulate, int_list);
+ANY_ITER_BENCHMARK(benchmark_range_accumulate, int_forward_list);
+ANY_ITER_BENCHMARK(benchmark_visit, int_vector);
+ANY_ITER_BENCHMARK(benchmark_visit, int_list);
 
-BENCHMARK_TEMPLATE(benchmark_iteration_map, std::map<int, int>::iterator)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-BENCHMARK_TEMPLATE(benchmark_iteration_map, tyti::any_iterator<std::pair<const int, int>>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
-BENCHMARK_TEMPLATE(benchmark_iteration_map, tyti::any_iterator_virtual<std::pair<const int,int>>)->Range(MY_RANGE_START, MY_RANGE_END)->Unit(tu)->RangeMultiplier(range_multi);
+// inline <-> inline and inline <-> heap switches
+using switch_variant_iter = tyti::variant_iterator<int, native_iter<int_vector>, native_iter<int_list>>;
+ANY_ITER_BENCHMARK(benchmark_type_switch, tyti::any_iterator<int>, int_list);
+ANY_ITER_BENCHMARK(benchmark_type_switch, tyti::any_iterator_virtual<const int>, int_list);
+ANY_ITER_BENCHMARK(benchmark_type_switch, switch_variant_iter, int_list);
+ANY_ITER_BENCHMARK(benchmark_type_switch, tyti::any_iterator<int>, padded_vector);
+ANY_ITER_BENCHMARK(benchmark_type_switch, tyti::any_iterator_virtual<const int>, padded_vector);
 
 BENCHMARK_MAIN();
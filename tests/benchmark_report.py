@@ -0,0 +1,173 @@
+"""Evaluates the JSON output of any_iter_benchmark.
+
+  report  <results.json> [--out ratios.json]
+      overhead ratios per benchmark, container and size:
+      any_iterator vs native iterator and any_iterator vs any_iterator_virtual,
+      and the fastest dispatch policy (any_iter, inline_iter, virtual_iter, switch_iter)
+  compare <baseline.json> <results.json> [--threshold 0.1]
+      flags benchmarks which got slower than the baseline by more than threshold,
+      returns 1 if there is any regression
+  plot    <results.json> <out_dir>
+      one svg per benchmark and container (needs matplotlib)
+
+The results are written by
+  any_iter_benchmark --benchmark_repetitions=5 --benchmark_report_aggregates_only=true
+                     --benchmark_out=results.json --benchmark_out_format=json
+see the benchmark targets in CMakeLists.txt.
+"""
+import argparse
+import collections
+import json
+import os
+import re
+import sys
+
+# e.g. benchmark_iteration<any_iter<int_list>, int_list>/4096
+NAME_RE = re.compile(r"^(?P<bench>\w+)<(?P<kind>\w+)<(?P<container>\w+)>, \w+>/(?P<size>\d+)$")
+
+Key = collections.namedtuple("Key", ["bench", "container", "size"])
+
+
+def load(filename):
+    """returns {run_name: cpu_time} of the median (or the only) run of every benchmark"""
+    with open(filename) as f:
+        data = json.load(f)
+    times = {}
+    for b in data["benchmarks"]:
+        name = b.get("run_name", b["name"])
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") != "median":
+                continue
+        elif name in times:
+            continue  # repetitions without aggregates, use the first one
+        times[name] = float(b["cpu_time"])
+    return times
+
+
+def group(times):
+    """returns {Key: {kind: cpu_time}} for all benchmarks comparing iterator kinds"""
+    groups = collections.defaultdict(dict)
+    for name, t in times.items():
+        m = NAME_RE.match(name)
+        if m:
+            groups[Key(m.group("bench"), m.group("container"), int(m.group("size")))][m.group("kind")] = t
+    return groups
+
+
+def ratio(groups, key, lhs, rhs):
+    g = groups[key]
+    if lhs in g and rhs in g and g[rhs] > 0:
+        return g[lhs] / g[rhs]
+    return None
+
+
+# iterator kinds of the dispatch policies, see tyti::table_dispatch
+DISPATCH_KINDS = ["any_iter", "inline_iter", "virtual_iter", "switch_iter"]
+
+
+def fastest(groups, key):
+    """returns the kind of the fastest dispatch policy which was measured for key"""
+    g = groups[key]
+    kinds = [k for k in DISPATCH_KINDS if k in g]
+    return min(kinds, key=lambda k: g[k]) if kinds else None
+
+
+def report(args):
+    groups = group(load(args.results))
+    rows = []
+    for key in sorted(groups):
+        rows.append({
+            "benchmark": key.bench,
+            "container": key.container,
+            "size": key.size,
+            "any_vs_native": ratio(groups, key, "any_iter", "native_iter"),
+            "any_vs_virtual": ratio(groups, key, "any_iter", "virtual_iter"),
+            "fastest_dispatch": fastest(groups, key),
+        })
+
+    def fmt(v):
+        return "{:10.2f}".format(v) if v is not None else "{:>10}".format("-")
+    print("{:28} {:18} {:>9} {:>10} {:>10} {:>12}".format("benchmark", "container", "size", "any/native", "any/virt", "fastest"))
+    for r in rows:
+        print("{:28} {:18} {:9d} {} {} {:>12}".format(r["benchmark"], r["container"], r["size"],
+                                                      fmt(r["any_vs_native"]), fmt(r["any_vs_virtual"]),
+                                                      r["fastest_dispatch"] or "-"))
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(rows, f, indent=2)
+    return 0
+
+
+def compare(args):
+    baseline = load(args.baseline)
+    current = load(args.results)
+    regressions = []
+    missing = 0
+    for name, t in sorted(current.items()):
+        if name not in baseline:
+            missing += 1
+            continue
+        change = t / baseline[name] - 1.0 if baseline[name] > 0 else 0.0
+        if change > args.threshold:
+            regressions.append((change, name, baseline[name], t))
+
+    print("compared {} benchmarks, {} not in the baseline, threshold {:.0%}".format(
+        len(current) - missing, missing, args.threshold))
+    for change, name, old, new in sorted(regressions, reverse=True):
+        print("REGRESSION {:+7.1%} {} ({:.4g} -> {:.4g})".format(change, name, old, new))
+    return 1 if regressions else 0
+
+
+def plot(args):
+    import matplotlib
+    matplotlib.use("Agg")
+    import matplotlib.pyplot as plt
+
+    groups = group(load(args.results))
+    series = collections.defaultdict(lambda: collections.defaultdict(list))
+    for key in sorted(groups):
+        for kind, t in groups[key].items():
+            series[(key.bench, key.container)][kind].append((key.size, key.size / t))
+
+    if not os.path.isdir(args.out_dir):
+        os.makedirs(args.out_dir)
+    for (bench, container), kinds in sorted(series.items()):
+        plt.xscale("log")
+        plt.xlabel("container size")
+        plt.ylabel("elements per cpu time unit")
+        plt.title("{} over {}".format(bench, container))
+        for kind, points in sorted(kinds.items()):
+            plt.plot([p[0] for p in points], [p[1] for p in points], "-.o", label=kind)
+        plt.legend()
+        plt.savefig(os.path.join(args.out_dir, "{}_{}.svg".format(bench, container)))
+        plt.clf()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command")
+    sub.required = True
+
+    p = sub.add_parser("report")
+    p.add_argument("results")
+    p.add_argument("--out")
+    p.set_defaults(func=report)
+
+    p = sub.add_parser("compare")
+    p.add_argument("baseline")
+    p.add_argument("results")
+    p.add_argument("--threshold", type=float, default=0.1)
+    p.set_defaults(func=compare)
+
+    p = sub.add_parser("plot")
+    p.add_argument("results")
+    p.add_argument("out_dir")
+    p.set_defaults(func=plot)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
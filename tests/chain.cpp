@@ -0,0 +1,129 @@
+#include <catch.hpp>
+#include <any_chain.hpp>
+#include "test_helpers.hpp"
+
+// containers
+#include <vector>
+#include <list>
+#include <map>
+
+#include <algorithm>
+#include <iterator>
+
+TEST_CASE("any_chain", "[chain]")
+{
+    std::vector<int> hot = { 1,2,3 };
+    std::list<int> overflow = { 4,5 };
+    std::vector<int> empty;
+    std::map<int, int> archive = { {6, 0}, {7, 0} };
+    std::vector<int> keys;
+    for (const auto& p : archive)
+        keys.push_back(p.first);
+
+    tyti::any_chain<int> chain;
+    chain.append(empty.begin(), empty.end());
+    chain.append(hot.begin(), hot.end());
+    chain.append(overflow.begin(), overflow.end());
+    chain.append(empty.begin(), empty.end());
+    chain.append(make_oversized(keys.begin()), make_oversized(keys.end()));
+    chain.append(make_oversized(overflow.begin()), make_oversized(overflow.end()));
+    const std::vector<int> expected = { 1,2,3,4,5,6,7,4,5 };
+
+    SECTION("iteration")
+    {
+        std::vector<int> out(chain.begin(), chain.end());
+        REQUIRE(out == expected);
+        REQUIRE(std::distance(chain.begin(), chain.end()) == 9);
+        REQUIRE(chain.size() == 9);
+        REQUIRE_FALSE(chain.empty());
+
+        auto it = chain.begin();
+        REQUIRE(it.segment_index() == 1); // the empty segment is skipped
+        REQUIRE(*it++ == 1);
+        std::advance(it, 2);
+        REQUIRE(*it == 4);
+        REQUIRE(it.segment_index() == 2);
+    }
+
+    SECTION("reverse iteration")
+    {
+        std::vector<int> out(std::reverse_iterator<tyti::any_chain<int>::iterator>(chain.end()),
+            std::reverse_iterator<tyti::any_chain<int>::iterator>(chain.begin()));
+        REQUIRE(std::equal(out.begin(), out.end(), expected.rbegin()));
+
+        auto it = chain.end();
+        --it;
+        REQUIRE(*it == 5);
+        std::advance(it, -4);
+        REQUIRE(*it == 5); // over the empty segment
+        REQUIRE(it.segment_index() == 2);
+        std::advance(it, -2);
+        REQUIRE(*it == 3);
+        REQUIRE(it.segment_index() == 1);
+    }
+
+    SECTION("algorithms")
+    {
+        REQUIRE(chain.accumulate(0) == 37);
+        REQUIRE(chain.accumulate(0L, [](long acc, int v) { return acc + 2 * v; }) == 74);
+        REQUIRE(chain.count_if([](int v) { return v == 4 || v == 5; }) == 4);
+
+        int sum = 0;
+        chain.for_each([&sum](int v) { sum += v; });
+        REQUIRE(sum == 37);
+
+        std::vector<int> out;
+        chain.copy(std::back_inserter(out));
+        REQUIRE(out == expected);
+
+        auto it = chain.find_if([](int v) { return v > 5; });
+        REQUIRE(*it == 6);
+        REQUIRE(it.segment_index() == 4);
+        REQUIRE(std::distance(chain.begin(), it) == 5);
+        REQUIRE(chain.find_if([](int v) { return v > 100; }) == chain.end());
+    }
+
+    SECTION("deref cache")
+    {
+        // the segment iterator is reassigned in place between segments of the same wrapped type
+        std::vector<int> more = { 8, 9 };
+        tyti::any_chain<int, tyti::cache_deref> cached;
+        cached.append(hot.begin(), hot.end());
+        cached.append(empty.begin(), empty.end());
+        cached.append(more.begin(), more.end());
+        cached.append(hot.begin(), hot.begin() + 1);
+        const std::vector<int> values = { 1,2,3,8,9,1 };
+
+        std::vector<int> forward;
+        for (auto it = cached.begin(); it != cached.end(); ++it)
+        {
+            REQUIRE(*it == *it);
+            forward.push_back(*it);
+        }
+        REQUIRE(forward == values);
+
+        std::vector<int> backward;
+        auto it = cached.end();
+        do
+        {
+            --it;
+            REQUIRE(*it == *it);
+            backward.push_back(*it);
+        } while (it != cached.begin());
+        REQUIRE(backward == std::vector<int>(values.rbegin(), values.rend()));
+    }
+
+    SECTION("empty chains")
+    {
+        tyti::any_chain<int> none;
+        REQUIRE(none.begin() == none.end());
+        REQUIRE(none.empty());
+        REQUIRE(none.accumulate(0) == 0);
+
+        tyti::any_chain<int> empties = { tyti::any_range<int>(empty.begin(), empty.end()),
+            tyti::any_range<int>(overflow.end(), overflow.end()) };
+        REQUIRE(empties.begin() == empties.end());
+        REQUIRE(empties.empty());
+        REQUIRE(empties.size() == 0);
+    }
+}
@@ -0,0 +1,406 @@
+#include <catch.hpp>
+#include <any_iterator.hpp>
+#include "any_iterator_virtual.hpp"
+#include "test_helpers.hpp"
+
+// containers
+#include <deque>
+#include <forward_list>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+// Runs every iterator category through any_iterator (and the bidirectional ones through
+// any_iterator_virtual, the vtable dispatch policy) and checks the cost contract: the number of allocations per operation.
+// Inline stored iterators never allocate, heap stored ones allocate once per construction or copy
+// and never in ++, --, *, == or an assignment of the same wrapped type.
+
+namespace {
+
+template<typename T, typename Category>
+using counted_any = tyti::any_iterator<T, Category, counting_alloc<unsigned char>>;
+
+// traversal of [_first, _last) with AnyIter, compared with the native iterators by address
+template<typename AnyIter, typename Iter>
+void check_traversal(Iter _first, Iter _last, std::forward_iterator_tag)
+{
+    AnyIter it(_first);
+    const AnyIter end(_last);
+    for (Iter native = _first; native != _last; ++native, ++it)
+    {
+        REQUIRE(it != end);
+        REQUIRE(&*it == &*native);
+    }
+    REQUIRE(it == end);
+
+    // multi pass
+    AnyIter a(_first);
+    const AnyIter b = a;
+    if (a != end)
+    {
+        ++a;
+        REQUIRE(&*b == &*_first);
+        REQUIRE(a != b);
+    }
+}
+
+template<typename AnyIter, typename Iter>
+void check_traversal(Iter _first, Iter _last, std::bidirectional_iterator_tag)
+{
+    check_traversal<AnyIter>(_first, _last, std::forward_iterator_tag());
+    AnyIter it(_last);
+    const AnyIter begin(_first);
+    for (Iter native = _last; native != _first;)
+    {
+        --native;
+        --it;
+        REQUIRE(&*it == &*native);
+    }
+    REQUIRE(it == begin);
+}
+
+template<typename AnyIter, typename Iter>
+void check_traversal(Iter _first, Iter _last, std::random_access_iterator_tag)
+{
+    check_traversal<AnyIter>(_first, _last, std::bidirectional_iterator_tag());
+    const AnyIter begin(_first);
+    const AnyIter end(_last);
+    const std::ptrdiff_t n = _last - _first;
+    REQUIRE(end - begin == n);
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+    {
+        REQUIRE(&begin[i] == &_first[i]);
+        REQUIRE(&*(begin + i) == &_first[i]);
+        REQUIRE(begin + i < end);
+    }
+    REQUIRE(begin + n == end);
+}
+
+template<typename AnyIter, typename Iter>
+void check_traversal(Iter _first, Iter _last)
+{
+    check_traversal<AnyIter>(_first, _last, typename std::iterator_traits<Iter>::iterator_category());
+}
+
+// allocations of the operations of forward (and better) any_iterators on [_first, _last), not empty
+template<typename AnyIter, typename Iter>
+void check_allocations(Iter _first, Iter _last, bool _heap)
+{
+    const int per_iterator = _heap ? 1 : 0;
+    allocation_probe probe;
+    {
+        AnyIter it(_first);
+        REQUIRE(probe.allocations() == per_iterator);
+
+        probe.reset();
+        const AnyIter end(_last);
+        AnyIter copy(it);
+        REQUIRE(probe.allocations() == 2 * per_iterator);
+
+        probe.reset();
+        AnyIter moved(std::move(copy));
+        copy = std::move(moved); // steals the block back
+        REQUIRE(probe.allocations() == 0);
+        REQUIRE(probe.deallocations() == 0);
+
+        for (; it != end; ++it)
+            (void)*it;
+        it = copy; // same wrapped type, assigned in place
+        it = _first;
+        copy = it;
+        REQUIRE(probe.allocations() == 0);
+        REQUIRE(probe.deallocations() == 0);
+        probe.reset();
+    }
+    REQUIRE(probe.deallocations() == 3 * per_iterator);
+}
+
+// type switches between the inline Iter and the heap stored oversized<Iter>
+template<typename AnyIter, typename Iter>
+void check_type_switch(Iter _it)
+{
+    allocation_probe probe;
+    {
+        AnyIter it(_it);
+        REQUIRE(probe.allocations() == 0);
+        it = make_oversized(_it);
+        REQUIRE(probe.allocations() == 1);
+        it = make_oversized(_it); // same type
+        REQUIRE(probe.allocations() == 1);
+        it = _it;
+        REQUIRE(probe.deallocations() == 1);
+        it = make_oversized(_it);
+        REQUIRE(probe.allocations() == 2);
+    }
+    REQUIRE(probe.deallocations() == 2);
+}
+
+// iterator whose copies (construction and assignment) throw while armed is set
+template<std::size_t Padding>
+struct throwing_iterator
+{
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = int*;
+    using reference = int&;
+
+    static bool armed;
+
+    int* p;
+    char padding[Padding];
+
+    explicit throwing_iterator(int* _p) : p(_p) {}
+    throwing_iterator(const throwing_iterator& _rhs) : p(_rhs.p)
+    {
+        if (armed)
+            throw std::runtime_error("copy");
+    }
+    throwing_iterator(throwing_iterator&& _rhs) noexcept : p(_rhs.p) {}
+    throwing_iterator& operator=(const throwing_iterator& _rhs)
+    {
+        if (armed)
+            throw std::runtime_error("assign");
+        p = _rhs.p;
+        return *this;
+    }
+
+    int& operator*() const { return *p; }
+    throwing_iterator& operator++() { ++p; return *this; }
+    bool operator==(const throwing_iterator& _rhs) const { return p == _rhs.p; }
+    bool operator!=(const throwing_iterator& _rhs) const { return p != _rhs.p; }
+};
+
+template<std::size_t Padding>
+bool throwing_iterator<Padding>::armed = false;
+
+// resets throwing_iterator::armed and allocation_counter::fail at the end of the scope
+template<std::size_t Padding>
+struct arm_guard
+{
+    arm_guard() { throwing_iterator<Padding>::armed = true; }
+    ~arm_guard() { throwing_iterator<Padding>::armed = false; allocation_counter::fail = false; }
+};
+
+template<std::size_t Padding>
+void check_exception_safety()
+{
+    using iter = counted_any<int, std::forward_iterator_tag>;
+    using throwing = throwing_iterator<Padding>;
+    int arr[] = { 1, 2, 3 };
+    allocation_probe probe;
+
+    SECTION("copy construction")
+    {
+        iter it{ throwing(arr) };
+        arm_guard<Padding> guard;
+        REQUIRE_THROWS_AS(iter(it), std::runtime_error);
+        REQUIRE(*it == 1);
+    }
+
+    SECTION("assignment of another type")
+    {
+        iter it(arr + 1);
+        const throwing src(arr);
+        arm_guard<Padding> guard;
+        REQUIRE_THROWS_AS(it = src, std::runtime_error);
+        // left empty, can be assigned again
+        it = arr + 2;
+        REQUIRE(*it == 3);
+    }
+
+    SECTION("assignment of the same type")
+    {
+        iter it{ throwing(arr + 1) };
+        const iter src{ throwing(arr) };
+        arm_guard<Padding> guard;
+        REQUIRE_THROWS_AS(it = src, std::runtime_error);
+        REQUIRE(*it == 2); // the wrapped assignment threw before changing the iterator
+        REQUIRE_THROWS_AS(it = throwing(arr), std::runtime_error);
+        REQUIRE(*it == 2);
+    }
+
+    SECTION("failing allocation")
+    {
+        iter it(arr);
+        arm_guard<Padding> guard;
+        throwing::armed = false;
+        allocation_counter::fail = true;
+        const oversized<int*> src(arr + 1);
+        REQUIRE_THROWS_AS(it = src, std::bad_alloc);
+        allocation_counter::fail = false;
+        it = src;
+        REQUIRE(*it == 2);
+    }
+
+    REQUIRE(probe.allocations() == probe.deallocations());
+}
+
+} // end namespace
+
+TEST_CASE("conformance: traversal", "[conformance]")
+{
+    std::vector<int> v = { 1, 2, 3, 4, 5 };
+    std::deque<int> d(v.begin(), v.end());
+    std::list<int> l(v.begin(), v.end());
+    std::forward_list<int> fl(v.begin(), v.end());
+    const std::set<int> s(v.begin(), v.end());
+    std::map<int, int> m = { { 1, 2 }, { 3, 4 } };
+
+    SECTION("input")
+    {
+        using iter = counted_any<const int, std::input_iterator_tag>;
+        std::istringstream in("1 2 3");
+        iter it{ std::istream_iterator<int>(in) };
+        const iter end{ std::istream_iterator<int>() };
+        std::vector<int> read;
+        for (; it != end; ++it)
+            read.push_back(*it);
+        REQUIRE(read == std::vector<int>({ 1, 2, 3 }));
+
+        std::istringstream in2("4 5");
+        iter big{ make_oversized(std::istream_iterator<int>(in2)) };
+        REQUIRE(*big++ == 4);
+        REQUIRE(*big == 5);
+    }
+
+    SECTION("output")
+    {
+        using iter = counted_any<int, std::output_iterator_tag>;
+        std::vector<int> out;
+        iter it{ std::back_inserter(out) };
+        *it = 1;
+        ++it;
+        *it++ = 2;
+        it = make_oversized(std::back_inserter(out));
+        *it++ = 3;
+        REQUIRE(out == std::vector<int>({ 1, 2, 3 }));
+    }
+
+    SECTION("forward")
+    {
+        check_traversal<counted_any<int, std::forward_iterator_tag>>(fl.begin(), fl.end());
+        check_traversal<counted_any<int, std::forward_iterator_tag>>(make_oversized(fl.begin()), make_oversized(fl.end()));
+    }
+
+    SECTION("bidirectional")
+    {
+        using iter = counted_any<int, std::bidirectional_iterator_tag>;
+        check_traversal<iter>(l.begin(), l.end());
+        check_traversal<iter>(make_oversized(l.begin()), make_oversized(l.end()));
+        check_traversal<counted_any<const int, std::bidirectional_iterator_tag>>(s.begin(), s.end());
+        check_traversal<counted_any<std::pair<const int, int>, std::bidirectional_iterator_tag>>(m.begin(), m.end());
+        // random access iterators as bidirectional any_iterators
+        check_traversal<iter>(v.begin(), v.end(), std::bidirectional_iterator_tag());
+    }
+
+    SECTION("random access")
+    {
+        using iter = counted_any<int, std::random_access_iterator_tag>;
+        check_traversal<iter>(v.data(), v.data() + v.size());
+        check_traversal<iter>(v.begin(), v.end());
+        check_traversal<iter>(d.begin(), d.end());
+        check_traversal<iter>(make_oversized(v.begin()), make_oversized(v.end()));
+        check_traversal<iter>(make_oversized(d.begin()), make_oversized(d.end()));
+    }
+
+    SECTION("any_iterator_virtual")
+    {
+        check_traversal<tyti::any_iterator_virtual<int>>(l.begin(), l.end());
+        check_traversal<tyti::any_iterator_virtual<int>>(v.begin(), v.end(), std::bidirectional_iterator_tag());
+        check_traversal<tyti::any_iterator_virtual<const int>>(s.begin(), s.end());
+        check_traversal<tyti::any_iterator_virtual<int>>(make_oversized(l.begin()), make_oversized(l.end()));
+    }
+}
+
+TEST_CASE("conformance: allocations per operation", "[conformance]")
+{
+    std::vector<int> v = { 1, 2, 3 };
+    std::deque<int> d(v.begin(), v.end());
+    std::list<int> l(v.begin(), v.end());
+    std::forward_list<int> fl(v.begin(), v.end());
+    const std::set<int> s(v.begin(), v.end());
+
+    SECTION("inline")
+    {
+        check_allocations<counted_any<int, std::forward_iterator_tag>>(fl.begin(), fl.end(), false);
+        check_allocations<counted_any<int, std::bidirectional_iterator_tag>>(l.begin(), l.end(), false);
+        check_allocations<counted_any<const int, std::bidirectional_iterator_tag>>(s.begin(), s.end(), false);
+        check_allocations<counted_any<int, std::random_access_iterator_tag>>(v.data(), v.data() + v.size(), false);
+        check_allocations<counted_any<int, std::random_access_iterator_tag>>(v.begin(), v.end(), false);
+        check_allocations<counted_any<int, std::random_access_iterator_tag>>(d.begin(), d.end(), false);
+    }
+
+    SECTION("heap")
+    {
+        check_allocations<counted_any<int, std::forward_iterator_tag>>(make_oversized(fl.begin()), make_oversized(fl.end()), true);
+        check_allocations<counted_any<int, std::bidirectional_iterator_tag>>(make_oversized(l.begin()), make_oversized(l.end()), true);
+        check_allocations<counted_any<int, std::random_access_iterator_tag>>(make_oversized(v.begin()), make_oversized(v.end()), true);
+    }
+
+    SECTION("dispatch policies")
+    {
+        // the storage does not depend on the dispatch
+        using virtual_iter = tyti::any_iterator<int, std::bidirectional_iterator_tag, counting_alloc<unsigned char>, tyti::virtual_dispatch>;
+        using switch_iter = tyti::any_iterator<int, std::bidirectional_iterator_tag, counting_alloc<unsigned char>,
+            tyti::switch_dispatch<std::list<int>::iterator, oversized<std::list<int>::iterator>>>;
+        check_allocations<virtual_iter>(l.begin(), l.end(), false);
+        check_allocations<virtual_iter>(make_oversized(l.begin()), make_oversized(l.end()), true);
+        check_type_switch<virtual_iter>(l.begin());
+        check_allocations<switch_iter>(l.begin(), l.end(), false);
+        check_allocations<switch_iter>(make_oversized(l.begin()), make_oversized(l.end()), true);
+        check_type_switch<switch_iter>(l.begin());
+    }
+
+    SECTION("type switches")
+    {
+        check_type_switch<counted_any<int, std::forward_iterator_tag>>(fl.begin());
+        check_type_switch<counted_any<int, std::bidirectional_iterator_tag>>(l.begin());
+        check_type_switch<counted_any<int, std::random_access_iterator_tag>>(d.begin());
+    }
+
+    SECTION("input and output")
+    {
+        std::istringstream in("1 2 3");
+        std::vector<int> out;
+        allocation_probe probe;
+        {
+            counted_any<const int, std::input_iterator_tag> it{ std::istream_iterator<int>(in) };
+            const counted_any<const int, std::input_iterator_tag> end{ std::istream_iterator<int>() };
+            counted_any<int, std::output_iterator_tag> o{ std::back_inserter(out) };
+            while (it != end)
+                *o++ = *it++;
+            REQUIRE(probe.allocations() == 0);
+
+            counted_any<int, std::output_iterator_tag> big{ make_oversized(std::back_inserter(out)) };
+            REQUIRE(probe.allocations() == 1);
+            *big++ = 4;
+            big = make_oversized(std::back_inserter(out));
+            REQUIRE(probe.allocations() == 1);
+        }
+        REQUIRE(probe.deallocations() == 1);
+        REQUIRE(out == std::vector<int>({ 1, 2, 3, 4 }));
+    }
+}
+
+TEST_CASE("conformance: exception safety", "[conformance]")
+{
+    SECTION("inline")
+    {
+        check_exception_safety<1>();
+    }
+
+    SECTION("heap")
+    {
+        check_exception_safety<64>();
+    }
+}
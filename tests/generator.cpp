@@ -0,0 +1,254 @@
+#include <catch.hpp>
+#include <any_iterator.hpp>
+#include <generator.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// allocator counting into the given counter, to check which allocator the frame comes from
+template<typename T>
+struct tracking_alloc
+{
+    using value_type = T;
+
+    int* count;
+
+    tracking_alloc() : count(&default_count) {}
+    explicit tracking_alloc(int* _count) : count(_count) {}
+    template<typename U>
+    tracking_alloc(const tracking_alloc<U>& _rhs) : count(_rhs.count) {}
+
+    T* allocate(std::size_t _n)
+    {
+        ++*count;
+        return std::allocator<T>().allocate(_n);
+    }
+
+    void deallocate(T* _ptr, std::size_t _n)
+    {
+        --*count;
+        std::allocator<T>().deallocate(_ptr, _n);
+    }
+
+    template<typename U>
+    bool operator==(const tracking_alloc<U>& _rhs) const { return count == _rhs.count; }
+    template<typename U>
+    bool operator!=(const tracking_alloc<U>& _rhs) const { return count != _rhs.count; }
+
+    static int default_count;
+};
+
+template<typename T>
+int tracking_alloc<T>::default_count = 0;
+
+using alloc = tracking_alloc<unsigned char>;
+
+// counts the copies made of it
+struct copy_counter
+{
+    static int copies;
+
+    int value;
+
+    explicit copy_counter(int _value) : value(_value) {}
+    copy_counter(const copy_counter& _rhs) : value(_rhs.value) { ++copies; }
+    copy_counter& operator=(const copy_counter& _rhs)
+    {
+        value = _rhs.value;
+        ++copies;
+        return *this;
+    }
+};
+int copy_counter::copies = 0;
+
+// stands in for a paged cursor, the pages are produced on demand
+tyti::generator<int> paged(int _pages, int _page_size, int& _fetched)
+{
+    std::vector<int> page;
+    for (int p = 0; p < _pages; ++p)
+    {
+        ++_fetched;
+        page.clear();
+        for (int i = 0; i < _page_size; ++i)
+            page.push_back(p * _page_size + i);
+        for (const int& v : page)
+            co_yield v;
+    }
+}
+
+template<typename T>
+tyti::generator<const T&> elements(const std::vector<T>& _v)
+{
+    for (const T& e : _v)
+        co_yield e;
+}
+
+tyti::generator<int&> mutable_elements(std::vector<int>& _v)
+{
+    for (int& e : _v)
+        co_yield e;
+}
+
+tyti::generator<std::string> temporaries(int _n)
+{
+    for (int i = 0; i < _n; ++i)
+        co_yield std::to_string(i);
+}
+
+tyti::generator<int> failing(int _n)
+{
+    for (int i = 0; i < _n; ++i)
+        co_yield i;
+    throw std::runtime_error("cursor lost");
+}
+
+tyti::generator<int, alloc> counted(std::allocator_arg_t, const alloc&, int _n)
+{
+    for (int i = 0; i < _n; ++i)
+        co_yield i;
+}
+
+tyti::generator<int, alloc> counted_default(int _n)
+{
+    for (int i = 0; i < _n; ++i)
+        co_yield i;
+}
+
+} // end namespace
+
+TEST_CASE("generator", "[generator]")
+{
+    using input_iter = tyti::any_iterator<int, std::input_iterator_tag>;
+
+    SECTION("streams through any_iterator")
+    {
+        int fetched = 0;
+        auto gen = paged(4, 3, fetched);
+        REQUIRE(fetched == 0); // lazy
+
+        input_iter it(gen.begin());
+        const input_iter last(gen.end());
+        REQUIRE(fetched == 1);
+        REQUIRE(*it == 0);
+        for (int i = 0; i < 3; ++i)
+            ++it;
+        REQUIRE(*it == 3);
+        REQUIRE(fetched == 2);
+
+        REQUIRE(std::accumulate(it, last, 0) == (3 + 11) * 9 / 2);
+        REQUIRE(fetched == 4);
+    }
+
+    SECTION("single pointer, compared bitwise")
+    {
+        using iter = tyti::generator<int>::iterator;
+        static_assert(sizeof(iter) == sizeof(void*), "");
+        static_assert(tyti::is_bitwise_comparable<iter>::value, "");
+        static_assert(std::is_same<std::iterator_traits<iter>::iterator_category, std::input_iterator_tag>::value, "");
+
+        int fetched = 0;
+        auto gen = paged(1, 2, fetched);
+        input_iter it(gen.begin());
+        REQUIRE(it != input_iter(gen.end()));
+        REQUIRE(*it++ == 0);
+        REQUIRE(*it == 1);
+        ++it;
+        REQUIRE(it == input_iter(gen.end()));
+    }
+
+    SECTION("yields by reference")
+    {
+        std::vector<copy_counter> v;
+        for (int i = 0; i < 5; ++i)
+            v.emplace_back(i);
+        copy_counter::copies = 0;
+
+        auto gen = elements(v);
+        tyti::any_iterator<copy_counter, std::input_iterator_tag> it(gen.begin()), last(gen.end());
+        for (std::size_t i = 0; it != last; ++it, ++i)
+        {
+            REQUIRE(&*it == &v[i]);
+            REQUIRE(it->value == static_cast<int>(i));
+        }
+        REQUIRE(copy_counter::copies == 0);
+    }
+
+    SECTION("mutable access")
+    {
+        std::vector<int> v = { 1, 2, 3 };
+        auto gen = mutable_elements(v);
+        tyti::any_iterator<int&, std::input_iterator_tag> it(gen.begin()), last(gen.end());
+        for (; it != last; ++it)
+            *it *= 10;
+        REQUIRE(v == std::vector<int>({ 10, 20, 30 }));
+    }
+
+    SECTION("temporaries live until the next increment")
+    {
+        auto gen = temporaries(12);
+        tyti::any_iterator<std::string, std::input_iterator_tag> it(gen.begin()), last(gen.end());
+        std::string all;
+        for (; it != last; ++it)
+            all += *it + ",";
+        REQUIRE(all == "0,1,2,3,4,5,6,7,8,9,10,11,");
+    }
+
+    SECTION("empty")
+    {
+        int fetched = 0;
+        auto gen = paged(0, 3, fetched);
+        REQUIRE(input_iter(gen.begin()) == input_iter(gen.end()));
+    }
+
+    SECTION("exceptions are rethrown")
+    {
+        auto gen = failing(2);
+        input_iter it(gen.begin());
+        REQUIRE(*it == 0);
+        ++it;
+        REQUIRE_THROWS_AS(++it, std::runtime_error);
+
+        auto at_begin = failing(0);
+        REQUIRE_THROWS_AS(at_begin.begin(), std::runtime_error);
+    }
+
+    SECTION("frame allocator")
+    {
+        int count = 0;
+        {
+            auto gen = counted(std::allocator_arg, alloc(&count), 3);
+            REQUIRE(count == 1);
+            tyti::any_iterator<int, std::input_iterator_tag, alloc> it(gen.begin(), alloc(&count));
+            const tyti::any_iterator<int, std::input_iterator_tag, alloc> last(gen.end(), alloc(&count));
+            REQUIRE(std::accumulate(it, last, 0) == 3);
+            REQUIRE(count == 1); // the iterators are stored inline
+        }
+        REQUIRE(count == 0);
+
+        const int before = alloc::default_count;
+        {
+            auto gen = counted_default(3);
+            REQUIRE(alloc::default_count == before + 1);
+            REQUIRE(std::accumulate(gen.begin(), gen.end(), 0) == 3);
+        }
+        REQUIRE(alloc::default_count == before);
+    }
+
+    SECTION("destroyed before the end")
+    {
+        int count = 0;
+        {
+            auto gen = counted(std::allocator_arg, alloc(&count), 100);
+            auto it = gen.begin();
+            ++it;
+            REQUIRE(*it == 1);
+        }
+        REQUIRE(count == 0);
+    }
+}
@@ -0,0 +1,174 @@
+#include <catch.hpp>
+#include <any_range.hpp>
+#include <parallel.hpp>
+#include "test_helpers.hpp"
+
+// containers
+#include <vector>
+#include <list>
+#include <map>
+
+#include <atomic>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+TEST_CASE("any_range algorithms", "[range]")
+{
+    std::vector<int> vc = { 5,10,20,40,80 };
+    std::list<int> vl(300);
+    int n = 0;
+    for (auto& v : vl)
+        v = n++;
+
+    SECTION("iteration")
+    {
+        tyti::any_range<int> r(vc.begin(), vc.end());
+        auto itc = vc.begin();
+        for (int v : r)
+            REQUIRE(v == *itc++);
+        REQUIRE(!r.empty());
+        REQUIRE(tyti::any_range<int>(vc.end(), vc.end()).empty());
+    }
+
+    SECTION("accumulate")
+    {
+        tyti::any_range<int> r(vc.begin(), vc.end());
+        REQUIRE(r.accumulate(0) == 155);
+        REQUIRE(r.accumulate(1, [](int a, int b) { return a * (b / 5); }) == 1 * 2 * 4 * 8 * 16);
+        r = tyti::any_range<int>(vl.begin(), vl.end());
+        REQUIRE(r.accumulate(0) == 299 * 300 / 2);
+    }
+
+    SECTION("find_if")
+    {
+        tyti::any_range<int> r(vl.begin(), vl.end());
+        auto it = r.find_if([](int v) { return v == 150; });
+        REQUIRE(it != r.end());
+        REQUIRE(*it == 150);
+        REQUIRE(r.find_if([](int v) { return v < 0; }) == r.end());
+        for (int v : { 0, 63, 64, 299 }) // first and last element of the blocks
+        {
+            auto found = r.find_if([v](int e) { return e == v; });
+            REQUIRE(*found == v);
+            REQUIRE(std::distance(found, r.end()) == 300 - v);
+        }
+
+        // the match is reached on the native iterator, not with one indirect ++ per element
+        tyti::any_range<int, tyti::count_stats> counted(vl.begin(), vl.end());
+        tyti::reset_iterator_stats();
+        REQUIRE(*counted.find_if([](int v) { return v == 150; }) == 150);
+        const tyti::iterator_stats& stats = stats_of<std::list<int>::iterator>();
+        REQUIRE(stats.inc == 0);
+        REQUIRE(stats.skip == 1);
+    }
+
+    SECTION("count_if and copy")
+    {
+        const tyti::any_range<int> r(vl.begin(), vl.end());
+        REQUIRE(r.count_if([](int v) { return v % 2 == 0; }) == 150);
+        std::vector<int> out;
+        r.copy(std::back_inserter(out));
+        REQUIRE(out.size() == vl.size());
+        REQUIRE(out.back() == 299);
+    }
+
+    SECTION("for_each and copies")
+    {
+        std::map<int, int> m = { {1, 2}, {3, 4} };
+        tyti::any_range<std::pair<const int, int>> r(m.begin(), m.end());
+        tyti::any_range<std::pair<const int, int>> cpy(r);
+        int sum = 0;
+        cpy.for_each([&sum](const std::pair<const int, int>& p) { sum += p.second; });
+        REQUIRE(sum == 6);
+        tyti::any_range<std::pair<const int, int>> moved(std::move(cpy));
+        REQUIRE(moved.begin() == r.begin());
+    }
+}
+
+TEST_CASE("any_range split and parallel algorithms", "[range][parallel]")
+{
+    std::vector<int> vc(1000);
+    std::iota(vc.begin(), vc.end(), 0);
+    std::list<int> vl(vc.begin(), vc.end());
+    const int sum = 999 * 1000 / 2;
+
+    SECTION("size and split")
+    {
+        tyti::any_range<int> rv(vc.begin(), vc.end());
+        tyti::any_range<int> rl(vl.begin(), vl.end());
+        REQUIRE(rv.size() == 1000);
+        REQUIRE(rl.size() == 1000);
+
+        for (const tyti::any_range<int>* r : { &rv, &rl })
+        {
+            const auto parts = r->split(7);
+            REQUIRE(parts.size() == 7);
+            REQUIRE(parts.front().begin() == r->begin());
+            REQUIRE(parts.back().end() == r->end());
+            int total = 0;
+            for (std::size_t i = 0; i < parts.size(); ++i)
+            {
+                // sizes differ by one at most, the longer parts come first
+                REQUIRE(parts[i].size() == (i < 1000 % 7 ? 143u : 142u));
+                if (i > 0)
+                    REQUIRE(parts[i].begin() == parts[i - 1].end());
+                total += parts[i].accumulate(0);
+            }
+            REQUIRE(total == sum);
+        }
+
+        // never more parts than elements
+        tyti::any_range<int> small(vl.begin(), std::next(vl.begin(), 3));
+        REQUIRE(small.split(8).size() == 3);
+        REQUIRE(tyti::any_range<int>(vl.end(), vl.end()).split(4).empty());
+    }
+
+    SECTION("parallel_reduce")
+    {
+        tyti::any_range<int> rv(vc.begin(), vc.end());
+        tyti::any_range<int> rl(vl.begin(), vl.end());
+        for (std::size_t threads : { 0, 1, 2, 4 })
+        {
+            REQUIRE(tyti::parallel_reduce(rv, 0, std::plus<int>(), threads) == sum);
+            REQUIRE(tyti::parallel_reduce(rl, 0, std::plus<int>(), threads) == sum);
+        }
+
+        // element and combine operation differ
+        std::map<int, int> m;
+        for (int i = 0; i < 100; ++i)
+            m[i] = 2 * i;
+        tyti::any_range<std::pair<const int, int>> rm(m.begin(), m.end());
+        const long values = tyti::parallel_reduce(rm, 0L,
+            [](long acc, const std::pair<const int, int>& p) { return acc + p.second; },
+            std::plus<long>(), 3);
+        REQUIRE(values == 99 * 100);
+    }
+
+    SECTION("parallel_for_each")
+    {
+        tyti::any_range<int> rl(vl.begin(), vl.end());
+        std::atomic<long> total{ 0 };
+        std::atomic<int> calls{ 0 };
+        tyti::parallel_for_each(rl, [&](int v) { total += v; ++calls; }, 4);
+        REQUIRE(total == sum);
+        REQUIRE(calls == 1000);
+
+        // no threads: the calling thread visits every element
+        total = 0;
+        calls = 0;
+        tyti::parallel_for_each(rl, [&](int v) { total += v; ++calls; }, 0);
+        REQUIRE(total == sum);
+        REQUIRE(calls == 1000);
+    }
+
+    SECTION("exceptions are rethrown")
+    {
+        tyti::any_range<int> rv(vc.begin(), vc.end());
+        REQUIRE_THROWS_AS(tyti::parallel_for_each(rv, [](int v)
+        {
+            if (v == 500)
+                throw std::runtime_error("500");
+        }, 4), std::runtime_error);
+    }
+}
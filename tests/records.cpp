@@ -0,0 +1,207 @@
+#include <catch.hpp>
+#include <any_iterator.hpp>
+#include <any_range.hpp>
+#include <record_file.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+struct point
+{
+    std::int32_t x;
+    std::int32_t y;
+};
+
+// writes the file on construction and removes it on destruction
+class temp_file
+{
+public:
+    explicit temp_file(const std::string& _content, const std::string& _path = "any_iterator_records_test.bin")
+        : path_(_path)
+    {
+        std::FILE* f = std::fopen(path_.c_str(), "wb");
+        REQUIRE(f);
+        REQUIRE(std::fwrite(_content.data(), 1, _content.size(), f) == _content.size());
+        std::fclose(f);
+    }
+    ~temp_file() { std::remove(path_.c_str()); }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+std::string fixed_content(int _n)
+{
+    std::string content;
+    for (int i = 0; i < _n; ++i)
+    {
+        const point p = { i, 2 * i };
+        content.append(reinterpret_cast<const char*>(&p), sizeof(p));
+    }
+    return content;
+}
+
+std::string prefixed_content(const std::vector<std::string>& _records)
+{
+    std::string content;
+    for (const std::string& r : _records)
+    {
+        const tyti::record_length n = static_cast<tyti::record_length>(r.size());
+        content.append(reinterpret_cast<const char*>(&n), sizeof(n));
+        content += r;
+    }
+    return content;
+}
+
+} // end namespace
+
+TEST_CASE("record files", "[records]")
+{
+    const std::vector<std::string> strings = { "first", "", "third record" };
+
+#if TYTI_HAS_MMAP
+    SECTION("mapped fixed size records")
+    {
+        temp_file file(fixed_content(1000));
+        const tyti::mapped_file mapped(file.path());
+        REQUIRE(mapped.size() == 1000 * sizeof(point));
+        const auto records = mapped.records<point>();
+        REQUIRE(records.end() - records.begin() == 1000);
+
+        tyti::any_iterator<point, std::random_access_iterator_tag> it(records.begin());
+        const tyti::any_iterator<point, std::random_access_iterator_tag> last(records.end());
+        REQUIRE(it[999].y == 1998);
+        REQUIRE(&*it == reinterpret_cast<const point*>(mapped.data())); // zero copy
+        long sum = 0;
+        for (; it != last; ++it)
+            sum += it->x;
+        REQUIRE(sum == 999 * 1000 / 2);
+
+        REQUIRE_THROWS_AS(mapped.records<point>(4), std::runtime_error);
+    }
+
+    SECTION("mapped length prefixed records")
+    {
+        temp_file file(prefixed_content(strings));
+        const tyti::mapped_file mapped(file.path(), tyti::mapped_file::access::random);
+        const auto records = mapped.prefixed_records();
+        const tyti::any_range<tyti::record_view, std::forward_iterator_tag, tyti::by_value> range(records.begin(), records.end());
+        std::vector<std::string> out;
+        range.for_each([&out](const tyti::record_view& r) { out.push_back(r.str()); });
+        REQUIRE(out == strings);
+        REQUIRE(range.size() == 3);
+
+        temp_file truncated(prefixed_content(strings).substr(0, 12), "any_iterator_truncated_test.bin");
+        const tyti::mapped_file bad(truncated.path());
+        auto it = bad.prefixed_records().begin();
+        REQUIRE((*it).str() == "first");
+        REQUIRE_THROWS_AS(++it, std::runtime_error);
+    }
+
+    SECTION("empty file")
+    {
+        temp_file file("");
+        const tyti::mapped_file mapped(file.path());
+        REQUIRE(mapped.size() == 0);
+        REQUIRE(mapped.records<point>().begin() == mapped.records<point>().end());
+        REQUIRE(mapped.prefixed_records().begin() == mapped.prefixed_records().end());
+    }
+#endif
+
+    SECTION("buffered fixed size records")
+    {
+        temp_file file(fixed_content(1000));
+        tyti::record_reader<point> reader(file.path(), 7); // records span several reads
+        tyti::any_iterator<point, std::input_iterator_tag> it(reader.begin());
+        const tyti::any_iterator<point, std::input_iterator_tag> last(reader.end());
+        REQUIRE((*it++).x == 0);
+        REQUIRE(it->x == 1);
+        long sum = 0;
+        int n = 1;
+        for (; it != last; ++it, ++n)
+            sum += it->y;
+        REQUIRE(n == 1000);
+        REQUIRE(sum == 999 * 1000);
+
+        temp_file truncated(fixed_content(10).substr(0, 10 * sizeof(point) - 1), "any_iterator_truncated_test.bin");
+        tyti::record_reader<point> bad(truncated.path(), 4);
+        tyti::any_iterator<point, std::input_iterator_tag> bad_it(bad.begin());
+        for (int i = 0; i < 7; ++i)
+            ++bad_it;
+        REQUIRE(bad_it->x == 7);
+        REQUIRE_THROWS_AS(++bad_it, std::runtime_error); // the last read ends in the middle of a record
+    }
+
+    SECTION("buffered length prefixed records")
+    {
+        temp_file file(prefixed_content(strings));
+        tyti::prefixed_record_reader reader(file.path());
+        std::vector<std::string> out;
+        auto it = reader.begin();
+        REQUIRE((*it++).str() == "first"); // the proxy keeps the record
+        out.push_back("first");
+        for (; it != reader.end(); ++it)
+            out.push_back((*it).str());
+        REQUIRE(out == strings);
+
+        temp_file truncated(prefixed_content(strings).substr(0, 12), "any_iterator_truncated_test.bin");
+        tyti::prefixed_record_reader bad(truncated.path());
+        auto bad_it = bad.begin();
+        REQUIRE((*bad_it).str() == "first");
+        REQUIRE_THROWS_AS(++bad_it, std::runtime_error);
+
+        // records bigger than the growth step of the buffer
+        const std::vector<std::string> big = { std::string(200000, 'x'), "small", std::string(70000, 'y') };
+        temp_file big_file(prefixed_content(big), "any_iterator_big_test.bin");
+        tyti::prefixed_record_reader big_reader(big_file.path());
+        std::vector<std::string> big_out;
+        for (auto big_it = big_reader.begin(); big_it != big_reader.end(); ++big_it)
+            big_out.push_back((*big_it).str());
+        REQUIRE(big_out == big);
+
+        // a corrupt length is reported as truncated record, not allocated
+        std::string corrupt = prefixed_content({ "first" });
+        const tyti::record_length huge = 0xfffffff0u;
+        corrupt.append(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        corrupt += "a few bytes";
+        temp_file oversized_length(corrupt, "any_iterator_corrupt_test.bin");
+        tyti::prefixed_record_reader corrupt_reader(oversized_length.path());
+        auto corrupt_it = corrupt_reader.begin();
+        REQUIRE((*corrupt_it).str() == "first");
+        REQUIRE_THROWS_AS(++corrupt_it, std::runtime_error);
+    }
+
+    SECTION("missing file")
+    {
+        REQUIRE_THROWS_AS(tyti::record_reader<point>("does/not/exist"), std::system_error);
+#if TYTI_HAS_MMAP
+        REQUIRE_THROWS_AS(tyti::mapped_file("does/not/exist"), std::system_error);
+#endif
+    }
+
+#if TYTI_HAS_MMAP
+    SECTION("read errors")
+    {
+        // POSIX: a directory can be opened, but not read
+        tyti::record_reader<point> reader(".");
+        tyti::prefixed_record_reader prefixed_reader(".");
+        try
+        {
+            reader.begin();
+            FAIL("no read error");
+        }
+        catch (const std::system_error& e)
+        {
+            REQUIRE(e.code() == std::errc::io_error);
+        }
+        REQUIRE_THROWS_AS(prefixed_reader.begin(), std::system_error);
+    }
+#endif
+}
@@ -0,0 +1,162 @@
+#include <catch.hpp>
+#include <any_iterator.hpp>
+#include <type_registry.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <thread>
+#include <vector>
+
+#if defined(REGISTRY_PLUGIN_MODULE)
+#include <dlfcn.h>
+#endif
+
+// see registry_plugin.cpp
+tyti::any_iterator<int> plugin_iterator(std::vector<int>::iterator _it);
+tyti::any_iterator<int> plugin_iterator(std::list<int>::iterator _it);
+const tyti::type_key& plugin_key();
+
+namespace {
+
+struct local_type {};
+
+} // end namespace
+
+namespace registry_test {
+
+template<int N>
+struct tag {};
+
+// simulated copies of the keys of another shared library
+tyti::type_key list_copy(&tyti::detail::type_name<std::list<int>::iterator>);
+tyti::type_key local_copy(&tyti::detail::type_name<local_type>);
+
+template<int N>
+struct tag_copy { static tyti::type_key key; };
+
+template<int N>
+tyti::type_key tag_copy<N>::key(&tyti::detail::type_name<tag<N>>);
+
+template<int... N>
+std::vector<const tyti::type_key*> tag_keys()
+{
+    return { &tyti::type_key_of<tag<N>>::key..., &tag_copy<N>::key... };
+}
+
+} // end namespace registry_test
+
+using namespace registry_test;
+
+TEST_CASE("type registry", "[registry]")
+{
+    const tyti::type_key& list_key = tyti::type_key_of<std::list<int>::iterator>::key;
+    const tyti::type_key& vector_key = tyti::type_key_of<std::vector<int>::iterator>::key;
+
+    SECTION("ids")
+    {
+        const std::uint32_t id = list_key.id();
+        REQUIRE(id != 0);
+        REQUIRE(list_key.id() == id);
+        REQUIRE(vector_key.id() != id);
+        REQUIRE(list_key.same_type(list_key));
+        REQUIRE(!list_key.same_type(vector_key));
+
+        REQUIRE(list_copy.id() == id);
+        REQUIRE(list_copy.same_type(list_key));
+
+        int listed = 0;
+        for (const tyti::registered_type* e = tyti::type_key::first(); e; e = e->next())
+        {
+            if (e->name() && std::strcmp(e->name(), list_copy.name()) == 0)
+            {
+                REQUIRE(e->id() == id);
+                REQUIRE(e->name() != list_copy.name()); // owned by the registry
+                ++listed;
+            }
+        }
+        REQUIRE(listed >= 2);
+    }
+
+    SECTION("types with internal linkage are not unified")
+    {
+        const tyti::type_key& local_key = tyti::type_key_of<local_type>::key;
+        REQUIRE(local_copy.id() != local_key.id());
+        REQUIRE(!local_copy.same_type(local_key));
+    }
+
+    SECTION("concurrent registration")
+    {
+        const std::vector<const tyti::type_key*> keys = tag_keys<0, 1, 2, 3>();
+        std::vector<std::vector<std::uint32_t>> ids(8, std::vector<std::uint32_t>(keys.size()));
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < ids.size(); ++t)
+        {
+            threads.emplace_back([&keys, &ids, t]
+            {
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                    ids[t][(i + t) % keys.size()] = keys[(i + t) % keys.size()]->id();
+            });
+        }
+        for (std::thread& t : threads)
+            t.join();
+
+        for (std::size_t t = 1; t < ids.size(); ++t)
+            REQUIRE(ids[t] == ids[0]);
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            REQUIRE(ids[0][i] == ids[0][i + 4]); // the copy has the id of the key
+            for (std::size_t j = 0; j < i; ++j)
+                REQUIRE(ids[0][i] != ids[0][j]);
+        }
+    }
+
+    SECTION("shared library identity")
+    {
+        REQUIRE(&plugin_key() != &list_key); // the library has its own copy
+        REQUIRE(plugin_key().id() == list_key.id());
+
+        std::list<int> l = { 1, 2, 3 };
+        tyti::any_iterator<int> first = plugin_iterator(l.begin());
+        const tyti::any_iterator<int> last(l.end());
+        REQUIRE(&first.wrapped_type() != &last.wrapped_type());
+        REQUIRE(first.wrapped_type().same_type(last.wrapped_type()));
+        int sum = 0;
+        for (; first != last; ++first) // terminates with the end created here
+            sum += *first;
+        REQUIRE(sum == 6);
+        REQUIRE(first == last);
+        REQUIRE(plugin_iterator(l.begin()) != last);
+
+        std::vector<int> v = { 1, 2, 3 };
+        REQUIRE(plugin_iterator(v.end()) == tyti::any_iterator<int>(v.end()));
+        REQUIRE(plugin_iterator(v.end()) != tyti::any_iterator<int>(l.end()));
+    }
+
+#if defined(REGISTRY_PLUGIN_MODULE)
+    SECTION("unloaded shared library")
+    {
+        using key_fn = const tyti::type_key&(*)();
+        std::uint32_t plugin_id = 0;
+        for (int round = 0; round < 2; ++round)
+        {
+            void* module = dlopen(REGISTRY_PLUGIN_MODULE, RTLD_NOW | RTLD_LOCAL);
+            REQUIRE(module);
+            const key_fn plugin_only_key = reinterpret_cast<key_fn>(dlsym(module, "registry_plugin_only_key"));
+            REQUIRE(plugin_only_key);
+            const std::uint32_t id = plugin_only_key().id();
+            REQUIRE(id != 0);
+            if (round == 1) // registered again by the reloaded library
+                REQUIRE(id == plugin_id);
+            plugin_id = id;
+            REQUIRE(dlclose(module) == 0);
+            REQUIRE(!dlopen(REGISTRY_PLUGIN_MODULE, RTLD_NOW | RTLD_NOLOAD)); // unmapped
+
+            // walks the registry past the entry of the unloaded key
+            const tyti::type_key& key = round == 0 ? tyti::type_key_of<tag<10>>::key : tyti::type_key_of<tag<11>>::key;
+            REQUIRE(key.id() != 0);
+            REQUIRE(key.id() != plugin_id);
+        }
+    }
+#endif
+}
@@ -0,0 +1,40 @@
+// Shared library of the "shared library identity" test (registry.cpp).
+// Built with hidden visibility, so it has its own function tables and type_keys.
+// Built a second time as module, which the "unloaded shared library" test loads with dlopen.
+#include <any_iterator.hpp>
+
+#include <list>
+#include <vector>
+
+#if defined(_WIN32)
+#define PLUGIN_API __declspec(dllexport)
+#else
+#define PLUGIN_API __attribute__((visibility("default")))
+#endif
+
+PLUGIN_API tyti::any_iterator<int> plugin_iterator(std::vector<int>::iterator _it)
+{
+    return tyti::any_iterator<int>(_it);
+}
+
+PLUGIN_API tyti::any_iterator<int> plugin_iterator(std::list<int>::iterator _it)
+{
+    return tyti::any_iterator<int>(_it);
+}
+
+PLUGIN_API const tyti::type_key& plugin_key()
+{
+    return tyti::type_key_of<std::list<int>::iterator>::key;
+}
+
+namespace registry_plugin {
+
+// only registered by the library
+struct plugin_only {};
+
+} // end namespace registry_plugin
+
+extern "C" PLUGIN_API const tyti::type_key& registry_plugin_only_key()
+{
+    return tyti::type_key_of<registry_plugin::plugin_only>::key;
+}
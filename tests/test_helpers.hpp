@@ -0,0 +1,120 @@
+#pragma once
+
+#include <iterator_stats.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <typeinfo>
+
+// Helpers shared by the tests: an iterator which is stored on the heap by any_iterator,
+// an allocator which counts the allocations of all its rebinds and the lookup of iterator_stats.
+
+// Iter with the same category, too big for the default inline buffer
+template<typename Iter>
+struct oversized
+{
+    using iterator_category = typename std::iterator_traits<Iter>::iterator_category;
+    using value_type = typename std::iterator_traits<Iter>::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::iterator_traits<Iter>::pointer;
+    using reference = typename std::iterator_traits<Iter>::reference;
+
+    mutable Iter it; // output iterators are dereferenced as non-const
+    char padding[64];
+
+    oversized() : it() {}
+    explicit oversized(Iter _it) : it(_it) {}
+
+    auto operator*() const -> decltype(*it) { return *it; }
+    oversized& operator++() { ++it; return *this; }
+    oversized operator++(int) { oversized tmp(*this); ++it; return tmp; }
+    oversized& operator--() { --it; return *this; }
+    oversized& operator+=(std::ptrdiff_t _n) { it += _n; return *this; }
+    std::ptrdiff_t operator-(const oversized& _rhs) const { return it - _rhs.it; }
+    reference operator[](std::ptrdiff_t _n) const { return it[_n]; }
+    bool operator<(const oversized& _rhs) const { return it < _rhs.it; }
+    bool operator==(const oversized& _rhs) const { return it == _rhs.it; }
+    bool operator!=(const oversized& _rhs) const { return it != _rhs.it; }
+};
+
+template<typename Iter>
+oversized<Iter> make_oversized(Iter _it) { return oversized<Iter>(_it); }
+
+// counters of counting_alloc, shared by all rebinds.
+// A template, so the header can define the counters for every test file.
+template<typename = void>
+struct allocation_counters
+{
+    static int allocations;
+    static int deallocations;
+    // the next allocations throw std::bad_alloc while set
+    static bool fail;
+};
+template<typename T> int allocation_counters<T>::allocations = 0;
+template<typename T> int allocation_counters<T>::deallocations = 0;
+template<typename T> bool allocation_counters<T>::fail = false;
+
+using allocation_counter = allocation_counters<>;
+
+template<typename T>
+struct counting_alloc
+{
+    using value_type = T;
+
+    counting_alloc() {}
+    template<typename U>
+    counting_alloc(const counting_alloc<U>&) {}
+
+    T* allocate(std::size_t _n)
+    {
+        if (allocation_counter::fail)
+            throw std::bad_alloc();
+        ++allocation_counter::allocations;
+        return std::allocator<T>().allocate(_n);
+    }
+
+    void deallocate(T* _ptr, std::size_t _n)
+    {
+        ++allocation_counter::deallocations;
+        std::allocator<T>().deallocate(_ptr, _n);
+    }
+
+    template<typename U>
+    bool operator==(const counting_alloc<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const counting_alloc<U>&) const { return false; }
+};
+
+// allocations and deallocations since the construction or the last reset
+class allocation_probe
+{
+    int allocations_;
+    int deallocations_;
+
+public:
+    allocation_probe() { reset(); }
+
+    void reset()
+    {
+        allocations_ = allocation_counter::allocations;
+        deallocations_ = allocation_counter::deallocations;
+    }
+
+    int allocations() const { return allocation_counter::allocations - allocations_; }
+    int deallocations() const { return allocation_counter::deallocations - deallocations_; }
+};
+
+// counters of the wrapped type Iter (the first registered ones, every counted any_iterator type
+// has its own), only for types which are wrapped by a single counted any_iterator type
+template<typename Iter>
+const tyti::iterator_stats& stats_of()
+{
+    for (const tyti::iterator_stats* s = tyti::iterator_stats::first(); s; s = s->next())
+        if (std::strcmp(s->name, typeid(Iter).name()) == 0)
+            return *s;
+    throw std::logic_error("type not counted");
+}
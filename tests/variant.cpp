@@ -0,0 +1,80 @@
+#include <catch.hpp>
+#include <variant_iterator.hpp>
+
+// containers
+#include <vector>
+#include <list>
+#include <forward_list>
+
+#include <algorithm>
+#include <numeric>
+
+TEST_CASE("variant_iterator", "[variant]")
+{
+    std::vector<int> vc = { 5,10,20 };
+    std::list<int> l = { 1,2,3,4 };
+    using iterator = tyti::variant_iterator<int, std::vector<int>::iterator, std::list<int>::iterator>;
+    static_assert(std::is_same<iterator::iterator_category, std::bidirectional_iterator_tag>::value,
+        "the weakest category is used");
+    static_assert(sizeof(iterator) == sizeof(std::list<int>::iterator) + sizeof(std::size_t), "no extra storage");
+
+    SECTION("iterate and switch type")
+    {
+        iterator it(vc.begin());
+        REQUIRE(it.index() == 0);
+        REQUIRE(std::accumulate(it, iterator(vc.end()), 0) == 35);
+        it = l.begin();
+        REQUIRE(it.index() == 1);
+        REQUIRE(*it++ == 1);
+        REQUIRE(*it == 2);
+        REQUIRE(*--it == 1);
+        REQUIRE(it == l.begin());
+        REQUIRE(it != iterator(vc.begin()));
+        REQUIRE(std::accumulate(it, iterator(l.end()), 0) == 10);
+    }
+
+    SECTION("copy and move")
+    {
+        iterator it(l.begin());
+        iterator cpy(it);
+        REQUIRE(cpy == it);
+        iterator moved(std::move(cpy));
+        REQUIRE(*moved == 1);
+        moved = iterator(vc.begin() + 1);
+        REQUIRE(*moved == 10);
+        moved = it;
+        REQUIRE(*moved == 1);
+    }
+
+    SECTION("random access")
+    {
+        using ra_iterator = tyti::variant_iterator<int&, std::vector<int>::iterator, int*>;
+        int arr[] = { 3,1,2 };
+        ra_iterator first(arr), last(arr + 3);
+        REQUIRE(last - first == 3);
+        REQUIRE(first[2] == 2);
+        std::sort(first, last);
+        REQUIRE(arr[0] == 1);
+        first = vc.begin();
+        REQUIRE(*(first + 2) == 20);
+        REQUIRE(std::lower_bound(first, ra_iterator(vc.end()), 10) - first == 1);
+    }
+
+    SECTION("hoisted dispatch")
+    {
+        iterator first(l.begin()), last(l.end());
+        int sum = 0;
+        tyti::for_each(first, last, [&sum](int v) { sum += v; });
+        REQUIRE(sum == 10);
+        const auto n = tyti::visit(first, last, [](auto _first, auto _last) { return std::distance(_first, _last); });
+        REQUIRE(n == 4);
+    }
+
+    SECTION("forward iterators")
+    {
+        std::forward_list<int> fl = { 1,2 };
+        tyti::variant_iterator<int, std::forward_list<int>::iterator, std::list<int>::iterator> it(fl.begin());
+        static_assert(std::is_same<decltype(it)::iterator_category, std::forward_iterator_tag>::value, "");
+        REQUIRE(*++it == 2);
+    }
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring> //memcpy, strcmp, strlen, strstr
+#include <thread> //yield
+
+#if !defined(__GNUC__) && !defined(__clang__) && !defined(_MSC_VER) && (defined(__GXX_RTTI) || defined(_CPPRTTI))
+#include <typeinfo>
+#endif
+
+// The registry has to be a single object in the process, so it is exported from every shared library
+// which instantiates it, even with -fvisibility=hidden. The dynamic linker binds all of them to the first one.
+#if !defined(TYTI_TYPE_REGISTRY_API)
+#if defined(__GNUC__) || defined(__clang__)
+#define TYTI_TYPE_REGISTRY_API __attribute__((visibility("default")))
+#else
+#define TYTI_TYPE_REGISTRY_API
+#endif
+#endif
+
+namespace tyti {
+
+namespace detail {
+
+// name of T which is equal in all shared libraries compiled with the same compiler, works without RTTI
+template<typename T>
+const char* type_name()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __PRETTY_FUNCTION__;
+#elif defined(_MSC_VER)
+    return __FUNCSIG__;
+#elif defined(__GXX_RTTI) || defined(_CPPRTTI)
+    return typeid(T).name();
+#else
+    return nullptr; // identified by the address of the type_key only
+#endif
+}
+
+// types in anonymous namespaces of different translation units can have the same name
+inline bool is_local_name(const char* _name)
+{
+    return !_name
+        || std::strstr(_name, "(anonymous namespace)") // clang
+        || std::strstr(_name, "{anonymous}") // gcc
+        || std::strstr(_name, "`anonymous namespace'"); // msvc
+}
+
+class type_key_list;
+
+} // end namespace detail
+
+/// Entry of the registry, one per registered type_key. The entries and the copies of the names
+/// belong to the registry, so the list stays valid after the shared library of a key is unloaded.
+class registered_type
+{
+public:
+    /// copy of the name of the type, nullptr if it has none (see detail::type_name)
+    const char* name() const { return name_; }
+    /// id of the type, see type_key::id. 0 while the entry is being registered.
+    std::uint32_t id() const { return id_.load(std::memory_order_acquire); }
+    const registered_type* next() const { return next_; }
+
+private:
+    registered_type(const char* _name, std::uint32_t _seq)
+        : name_(copy(_name)), local_(detail::is_local_name(_name)), seq_(_seq), id_(0), next_(nullptr)
+    {
+    }
+
+    static char* copy(const char* _name)
+    {
+        if (!_name)
+            return nullptr;
+        const std::size_t n = std::strlen(_name) + 1;
+        char* name = new char[n];
+        std::memcpy(name, _name, n);
+        return name;
+    }
+
+    char* const name_;
+    const bool local_;
+    // position in the registry
+    const std::uint32_t seq_;
+    std::atomic<std::uint32_t> id_;
+    const registered_type* next_;
+
+    friend class detail::type_key_list;
+};
+
+/// Process wide identity of a type, e.g. of the iterator wrapped by an any_iterator.
+/// Every function table of any_iterator refers to the type_key_of its wrapped type.
+/// Shared libraries built with hidden visibility (or loaded with RTLD_LOCAL) get their own copies
+/// of the function tables and of the keys. id() is equal for all copies of the key of a type,
+/// so iterators created in different libraries still compare equal.
+/// The keys are constant initialized (no static initialization guard) and registered lazily on
+/// the first call of id(), which is lock free afterwards (one atomic load).
+/// Types with internal linkage (anonymous namespaces) are not unified between libraries.
+/// Keys have to have static storage duration. Registering a key copies its name into an entry of
+/// the registry, which never refers to the key again. Shared libraries may therefore be unloaded
+/// after their keys were registered; the entries stay (a few bytes per type, never freed) and
+/// keep the id, so the type gets the same id when the library is loaded again.
+/// The keys (and any_iterators) of an unloaded library must not be used anymore.
+class type_key
+{
+public:
+    constexpr explicit type_key(const char*(*_name)())
+        : name_fn_(_name), id_(0), linked_(false), list_(nullptr)
+    {
+    }
+
+    type_key(const type_key&) = delete;
+    type_key& operator=(const type_key&) = delete;
+
+    /// name of the type, see detail::type_name
+    const char* name() const { return name_fn_(); }
+
+    /// Stable id of the type in this process, starting at 1 in the order of registration.
+    /// Equal for all copies of the key of a type (see above).
+    std::uint32_t id() const
+    {
+        const std::uint32_t id = id_.load(std::memory_order_acquire);
+        return id ? id : resolve();
+    }
+
+    /// true if both keys identify the same type. Keys of different registries (e.g. the registry was
+    /// not exported from a shared library) are compared by name.
+    bool same_type(const type_key& _rhs) const
+    {
+        if (this == &_rhs)
+            return true;
+        if (id() == _rhs.id() && list_ == _rhs.list_)
+            return true;
+        return list_ != _rhs.list_ && !detail::is_local_name(name()) && std::strcmp(name(), _rhs.name()) == 0;
+    }
+
+    /// newest entry of the registry, the others follow with next()
+    static const registered_type* first();
+
+private:
+    std::uint32_t resolve() const;
+
+    const char*(*const name_fn_)();
+    mutable std::atomic<std::uint32_t> id_;
+    mutable std::atomic<bool> linked_;
+    // registry of the key, set before the id is published
+    mutable const detail::type_key_list* list_;
+};
+
+namespace detail {
+
+// lock free list of the entries of all registered keys, new entries are pushed to the front
+class type_key_list
+{
+public:
+    constexpr type_key_list() : head_(nullptr), count_(0) {}
+
+    static TYTI_TYPE_REGISTRY_API type_key_list& instance()
+    {
+        static type_key_list list; // constant initialized, no guard
+        return list;
+    }
+
+    const registered_type* first() const { return head_.load(std::memory_order_acquire); }
+
+    // publishes an entry for _name and returns the id of the type: the position of the oldest entry
+    // with the same name. Entries are only pushed in front, so every later entry of the type finds
+    // the oldest one behind itself. Only entries are read, never the keys of other libraries.
+    std::uint32_t push(const char* _name)
+    {
+        registered_type* entry = new registered_type(_name, count_.fetch_add(1, std::memory_order_relaxed) + 1);
+        const registered_type* head = head_.load(std::memory_order_acquire);
+        do
+        {
+            entry->next_ = head;
+        } while (!head_.compare_exchange_weak(head, entry, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        std::uint32_t id = entry->seq_;
+        if (!entry->local_)
+        {
+            for (const registered_type* e = entry->next_; e; e = e->next_)
+            {
+                if (!e->local_ && std::strcmp(entry->name_, e->name_) == 0)
+                    id = e->seq_;
+            }
+        }
+        entry->id_.store(id, std::memory_order_release);
+        return id;
+    }
+
+private:
+    std::atomic<const registered_type*> head_;
+    std::atomic<std::uint32_t> count_;
+};
+
+} // end namespace detail
+
+inline const registered_type* type_key::first()
+{
+    return detail::type_key_list::instance().first();
+}
+
+inline std::uint32_t type_key::resolve() const
+{
+    if (!linked_.exchange(true, std::memory_order_acq_rel))
+    {
+        detail::type_key_list& list = detail::type_key_list::instance();
+        std::uint32_t id;
+        try
+        {
+            id = list.push(name());
+        }
+        catch (...)
+        {
+            linked_.store(false, std::memory_order_release);
+            throw;
+        }
+        list_ = &list;
+        id_.store(id, std::memory_order_release);
+        return id;
+    }
+    // registered concurrently by another thread, which is about to publish the id
+    std::uint32_t id;
+    while ((id = id_.load(std::memory_order_acquire)) == 0)
+        std::this_thread::yield();
+    return id;
+}
+
+/// The type_key of T
+template<typename T>
+struct type_key_of
+{
+    static type_key key;
+};
+
+template<typename T>
+type_key type_key_of<T>::key(&detail::type_name<T>);
+
+} // end namespace tyti
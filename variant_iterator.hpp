@@ -0,0 +1,402 @@
+#pragma once
+
+#include <iterator>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new> //placement new
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tyti {
+
+namespace detail {
+
+template<typename T, typename... Ts>
+struct index_of;
+
+template<typename T, typename... Ts>
+struct index_of<T, T, Ts...> : std::integral_constant<std::size_t, 0> {};
+
+template<typename T, typename U, typename... Ts>
+struct index_of<T, U, Ts...> : std::integral_constant<std::size_t, 1 + index_of<T, Ts...>::value> {};
+
+template<typename T, typename... Ts>
+struct contains : std::false_type {};
+
+template<typename T, typename U, typename... Ts>
+struct contains<T, U, Ts...> : std::integral_constant<bool, std::is_same<T, U>::value || contains<T, Ts...>::value> {};
+
+template<typename... Ts>
+struct is_unique : std::true_type {};
+
+template<typename T, typename... Ts>
+struct is_unique<T, Ts...> : std::integral_constant<bool, !contains<T, Ts...>::value && is_unique<Ts...>::value> {};
+
+template<typename... Ts>
+struct max_size : std::integral_constant<std::size_t, 0> {};
+
+template<typename T, typename... Ts>
+struct max_size<T, Ts...> : std::integral_constant<std::size_t,
+    (sizeof(T) > max_size<Ts...>::value) ? sizeof(T) : max_size<Ts...>::value> {};
+
+template<typename... Ts>
+struct all_of : std::true_type {};
+
+template<typename B, typename... Bs>
+struct all_of<B, Bs...> : std::integral_constant<bool, B::value && all_of<Bs...>::value> {};
+
+// calls _f with the alternative _index of the storage.
+// The chain of index comparisons is inlined, compilers turn it into a switch / jump table.
+template<std::size_t I, typename Iter, typename... Rest>
+struct variant_dispatch
+{
+    template<typename R, typename F>
+    static R apply(std::size_t _index, void* _storage, F&& _f)
+    {
+        if (_index == I)
+            return std::forward<F>(_f)(*reinterpret_cast<Iter*>(_storage));
+        return variant_dispatch<I + 1, Rest...>::template apply<R>(_index, _storage, std::forward<F>(_f));
+    }
+
+    template<typename R, typename F>
+    static R apply(std::size_t _index, const void* _storage, F&& _f)
+    {
+        if (_index == I)
+            return std::forward<F>(_f)(*reinterpret_cast<const Iter*>(_storage));
+        return variant_dispatch<I + 1, Rest...>::template apply<R>(_index, _storage, std::forward<F>(_f));
+    }
+};
+
+template<std::size_t I, typename Iter>
+struct variant_dispatch<I, Iter>
+{
+    template<typename R, typename F>
+    static R apply(std::size_t _index, void* _storage, F&& _f)
+    {
+        assert(_index == I);
+        (void)_index;
+        return std::forward<F>(_f)(*reinterpret_cast<Iter*>(_storage));
+    }
+
+    template<typename R, typename F>
+    static R apply(std::size_t _index, const void* _storage, F&& _f)
+    {
+        assert(_index == I);
+        (void)_index;
+        return std::forward<F>(_f)(*reinterpret_cast<const Iter*>(_storage));
+    }
+};
+
+} // end namespace detail
+
+/// Iterator which holds one of the iterator types Iters... .
+/// Same interface as any_iterator<T>, but the set of wrapped types is fixed at compile time:
+/// the iterator is stored inline (like a std::variant) and every operation dispatches
+/// with a switch over the type index. No heap allocation and no function pointers,
+/// so the compiler can inline the operations of all alternatives.
+/// The category is the weakest category of all Iters.
+/// variant_iterator<T, ...> gives const access, variant_iterator<T&, ...> gives mutable access.
+template<typename T, typename... Iters>
+class variant_iterator
+{
+    static_assert(sizeof...(Iters) > 0, "variant_iterator requires at least one iterator type");
+    static_assert(detail::is_unique<Iters...>::value, "the iterator types of a variant_iterator have to be distinct");
+
+public:
+    using iterator_category = typename std::common_type<typename std::iterator_traits<Iters>::iterator_category...>::type;
+    using value_type = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
+    using difference_type = std::ptrdiff_t;
+
+private:
+    using element_type = typename std::conditional<std::is_reference<T>::value,
+        typename std::remove_reference<T>::type, const T>::type;
+
+public:
+    using pointer = element_type*;
+    using reference = element_type&;
+
+private:
+    using dispatch = detail::variant_dispatch<0, Iters...>;
+
+    static constexpr bool is_bidirectional = std::is_base_of<std::bidirectional_iterator_tag, iterator_category>::value;
+    static constexpr bool is_random_access = std::is_base_of<std::random_access_iterator_tag, iterator_category>::value;
+
+    static_assert(std::is_base_of<std::input_iterator_tag, iterator_category>::value,
+        "variant_iterator requires input iterators");
+    static_assert(detail::all_of<std::is_nothrow_move_constructible<Iters>...>::value,
+        "variant_iterator requires nothrow move constructible iterators");
+    static_assert(detail::all_of<std::is_convertible<typename std::iterator_traits<Iters>::pointer, pointer>...>::value,
+        "the elements of all iterators have to be accessible as T");
+
+    template<typename Iter>
+    using index_of = detail::index_of<typename std::decay<Iter>::type, Iters...>;
+
+    template<typename Iter>
+    Iter& get() { return *reinterpret_cast<Iter*>(storage()); }
+    template<typename Iter>
+    const Iter& get() const { return *reinterpret_cast<const Iter*>(storage()); }
+
+    void* storage() { return &buffer_; }
+    const void* storage() const { return &buffer_; }
+
+    void destruct()
+    {
+        visit([](auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            _it.~Iter();
+        });
+    }
+
+    template<typename U, typename... Is, typename F>
+    friend decltype(auto) visit(const variant_iterator<U, Is...>& _first, const variant_iterator<U, Is...>& _last, F&& _f);
+
+    // member variables
+    alignas(Iters...) unsigned char buffer_[detail::max_size<Iters...>::value];
+    std::size_t index_;
+
+    /// Interface
+public:
+    template<typename IterType, class = typename std::enable_if<!std::is_same<typename std::decay<IterType>::type, variant_iterator>::value>::type>
+    explicit variant_iterator(IterType&& _iter)
+        : index_(index_of<IterType>::value)
+    {
+        new (storage()) typename std::decay<IterType>::type(std::forward<IterType>(_iter));
+    }
+
+    variant_iterator(const variant_iterator& _iter)
+        : index_(_iter.index_)
+    {
+        _iter.visit([this](const auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            new (storage()) Iter(_it);
+        });
+    }
+
+    variant_iterator(variant_iterator&& _iter) noexcept
+        : index_(_iter.index_)
+    {
+        _iter.visit([this](auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            new (storage()) Iter(std::move(_it));
+        });
+    }
+
+    template<typename IterType, class = typename std::enable_if<!std::is_same<typename std::decay<IterType>::type, variant_iterator>::value>::type>
+    variant_iterator& operator=(IterType&& _iter)
+    {
+        using Iter = typename std::decay<IterType>::type;
+        if (index_ == index_of<Iter>::value)
+            get<Iter>() = std::forward<IterType>(_iter);
+        else
+            *this = variant_iterator(std::forward<IterType>(_iter));
+        return *this;
+    }
+
+    // iterators of another type are copied before the current one is destructed
+    variant_iterator& operator=(const variant_iterator& _iter)
+    {
+        if (this == &_iter)
+            return *this;
+        if (index_ == _iter.index_)
+        {
+            _iter.visit([this](const auto& _it)
+            {
+                using Iter = typename std::decay<decltype(_it)>::type;
+                get<Iter>() = _it;
+            });
+            return *this;
+        }
+        return *this = variant_iterator(_iter);
+    }
+
+    variant_iterator& operator=(variant_iterator&& _iter) noexcept
+    {
+        if (this == &_iter)
+            return *this;
+        destruct();
+        index_ = _iter.index_;
+        _iter.visit([this](auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            new (storage()) Iter(std::move(_it));
+        });
+        return *this;
+    }
+
+    ~variant_iterator()
+    {
+        destruct();
+    }
+
+    /// index of the wrapped type in Iters...
+    std::size_t index() const { return index_; }
+
+    /// Calls _f with the wrapped iterator, allows hoisting the dispatch out of loops.
+    /// The result type is the one of _f called with the first type of Iters.
+    template<typename F>
+    decltype(auto) visit(F&& _f)
+    {
+        using R = decltype(std::forward<F>(_f)(std::declval<typename std::tuple_element<0, std::tuple<Iters...>>::type&>()));
+        return dispatch::template apply<R>(index_, storage(), std::forward<F>(_f));
+    }
+
+    template<typename F>
+    decltype(auto) visit(F&& _f) const
+    {
+        using R = decltype(std::forward<F>(_f)(std::declval<const typename std::tuple_element<0, std::tuple<Iters...>>::type&>()));
+        return dispatch::template apply<R>(index_, storage(), std::forward<F>(_f));
+    }
+
+    bool operator==(const variant_iterator& _rhs) const
+    {
+        if (index_ != _rhs.index_) //different types
+            return false;
+        return visit([&_rhs](const auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            return _it == _rhs.template get<Iter>();
+        });
+    }
+
+    bool operator!=(const variant_iterator& _rhs) const
+    {
+        return !operator==(_rhs);
+    }
+
+    // comparison with the native iterator. The wrapped iterator must be of type IterType.
+    template<typename IterType>
+    bool operator==(const IterType& _rhs) const {
+        assert(index_ == index_of<IterType>::value);
+        return get<IterType>() == _rhs;
+    }
+
+    template<typename IterType>
+    bool operator!=(const IterType& _rhs) const {
+        return !operator==(_rhs);
+    }
+
+    variant_iterator& operator++() {
+        visit([](auto& _it) { ++_it; });
+        return *this;
+    }
+
+    variant_iterator operator++(int) {
+        variant_iterator cpy(*this);
+        ++*this;
+        return cpy;
+    }
+
+    variant_iterator& operator--() {
+        static_assert(is_bidirectional, "decrement requires bidirectional iterators");
+        visit([](auto& _it) { --_it; });
+        return *this;
+    }
+
+    variant_iterator operator--(int) {
+        variant_iterator cpy(*this);
+        --*this;
+        return cpy;
+    }
+
+    variant_iterator& operator+=(std::ptrdiff_t _n) {
+        static_assert(is_random_access, "operator+= requires random access iterators");
+        visit([_n](auto& _it) { _it += _n; });
+        return *this;
+    }
+
+    variant_iterator& operator-=(std::ptrdiff_t _n) {
+        return operator+=(-_n);
+    }
+
+    variant_iterator operator+(std::ptrdiff_t _n) const {
+        variant_iterator cpy(*this);
+        cpy += _n;
+        return cpy;
+    }
+
+    friend variant_iterator operator+(std::ptrdiff_t _n, const variant_iterator& _iter) {
+        return _iter + _n;
+    }
+
+    variant_iterator operator-(std::ptrdiff_t _n) const {
+        return operator+(-_n);
+    }
+
+    // both iterators have to wrap the same type
+    std::ptrdiff_t operator-(const variant_iterator& _rhs) const {
+        static_assert(is_random_access, "operator- requires random access iterators");
+        assert(index_ == _rhs.index_);
+        return visit([&_rhs](const auto& _it) -> std::ptrdiff_t
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            return _it - _rhs.template get<Iter>();
+        });
+    }
+
+    reference operator[](std::ptrdiff_t _n) const {
+        static_assert(is_random_access, "operator[] requires random access iterators");
+        return visit([_n](const auto& _it) -> reference { return _it[_n]; });
+    }
+
+    bool operator<(const variant_iterator& _rhs) const {
+        static_assert(is_random_access, "operator< requires random access iterators");
+        assert(index_ == _rhs.index_);
+        return visit([&_rhs](const auto& _it)
+        {
+            using Iter = typename std::decay<decltype(_it)>::type;
+            return _it < _rhs.template get<Iter>();
+        });
+    }
+
+    bool operator>(const variant_iterator& _rhs) const {
+        return _rhs < *this;
+    }
+
+    bool operator<=(const variant_iterator& _rhs) const {
+        return !(_rhs < *this);
+    }
+
+    bool operator>=(const variant_iterator& _rhs) const {
+        return !(*this < _rhs);
+    }
+
+    reference operator*() const {
+        return visit([](const auto& _it) -> reference { return *_it; });
+    }
+
+    pointer operator->() const {
+        return &**this;
+    }
+};
+
+/// Calls _f(first, last) with the wrapped iterators, so the loop inside of _f runs on the native type.
+/// Both iterators have to wrap the same type.
+template<typename T, typename... Iters, typename F>
+decltype(auto) visit(const variant_iterator<T, Iters...>& _first, const variant_iterator<T, Iters...>& _last, F&& _f)
+{
+    assert(_first.index() == _last.index());
+    return _first.visit([&](const auto& _it)
+    {
+        using Iter = typename std::decay<decltype(_it)>::type;
+        return std::forward<F>(_f)(_it, _last.template get<Iter>());
+    });
+}
+
+/// Applies _f to every element in [_first, _last).
+/// Dispatches once, the loop runs on the wrapped iterator type.
+template<typename T, typename... Iters, typename F>
+F for_each(const variant_iterator<T, Iters...>& _first, const variant_iterator<T, Iters...>& _last, F _f)
+{
+    return visit(_first, _last, [&_f](auto _it, auto _end)
+    {
+        return std::for_each(_it, _end, std::move(_f));
+    });
+}
+
+} // end namespace tyti